@@ -4,33 +4,443 @@
 // Include nescessary files
 #include "plugin.hpp"
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <complex>
+#include <chrono>
 #include <samplerate.h>
+#include <osdialog.h>
 
 // define buffer length and max count of unison channels as constants
 
 #define	BufferLength  (1<<19) // buffer length with bit shift operation - on 48khz 16bit this should be around 2,73 seconds
 #define uni_chans (8)
+#define ShortLength (1<<9) // ring length of the short delay pool - 16 kB for all voices, enough for pitches above ~190 Hz at 48 kHz
+#define TransferChunk (64) // samples per voice that a snapshot capture or recall copies in one process call, small enough for 96 kHz
 
 
-// create custom knobs
+// Resonator Snapshot: live state of the delay lines and filters
 
 
-struct BigLuggezKnob : RoundKnob {
-	BigLuggezKnob() {
-		setSvg(APP->window->loadSvg(asset::plugin(pluginInstance, "res/BigLuggezKnob.svg")));
-	}
+// only the active part of each delay line is stored (oldest sample first, newest last): the first lengths[ch] samples of
+// samples[ch]. captures keep the full BufferLength, so the audio thread never has to resize them
+struct ResonatorSnapshot {
+	int voices = 0;
+	float sample_rate = 0.f;
+	int lengths[uni_chans] = {};
+	float last_delay_out[uni_chans] = {};
+	float filter_x[uni_chans][2] = {};
+	float filter_y[uni_chans][2] = {};
+	float dc_block_x[uni_chans][2] = {};
+	float dc_block_y[uni_chans][2] = {};
+	std::vector<float> samples[uni_chans];
 };
 
-struct MediumLuggezKnob : RoundKnob {
-	MediumLuggezKnob() {
-		setSvg(APP->window->loadSvg(asset::plugin(pluginInstance, "res/MediumLuggezKnob.svg")));
+// binary format: header, per voice filter state and the raw samples, little endian like every platform rack runs on.
+// the delay lines hold noisy audio, a lossless codec would barely shrink them
+#define SnapshotMagic (0x45414c41) // "ALAE"
+#define SnapshotVersion (2)
+
+static void putU32(std::vector<uint8_t>& out, uint32_t v) {
+	for (int i = 0; i < 4; i++) out.push_back((v >> (8 * i)) & 0xff);
+}
+
+static void putFloat(std::vector<uint8_t>& out, float f) {
+	uint32_t v;
+	std::memcpy(&v, &f, 4);
+	putU32(out, v);
+}
+
+static bool getU32(const std::vector<uint8_t>& in, size_t& pos, uint32_t& v) {
+	if (pos + 4 > in.size()) return false;
+	v = 0;
+	for (int i = 0; i < 4; i++) v |= uint32_t(in[pos++]) << (8 * i);
+	return true;
+}
+
+static bool getFloat(const std::vector<uint8_t>& in, size_t& pos, float& f) {
+	uint32_t v;
+	if (!getU32(in, pos, v)) return false;
+	std::memcpy(&f, &v, 4);
+	return true;
+}
+
+static std::vector<uint8_t> encodeSnapshot(const ResonatorSnapshot& s) {
+	std::vector<uint8_t> out;
+	putU32(out, SnapshotMagic);
+	putU32(out, SnapshotVersion);
+	putU32(out, s.voices);
+	putFloat(out, s.sample_rate);
+
+	for (int ch = 0; ch < s.voices; ch++) {
+		putFloat(out, s.last_delay_out[ch]);
+		for (int i = 0; i < 2; i++) {
+			putFloat(out, s.filter_x[ch][i]);
+			putFloat(out, s.filter_y[ch][i]);
+			putFloat(out, s.dc_block_x[ch][i]);
+			putFloat(out, s.dc_block_y[ch][i]);
+		}
+		putU32(out, s.lengths[ch]);
+
+		size_t pos = out.size();
+		out.resize(pos + 4 * s.lengths[ch]);
+		std::memcpy(&out[pos], s.samples[ch].data(), 4 * s.lengths[ch]);
+	}
+	return out;
+}
+
+static bool decodeSnapshot(const std::vector<uint8_t>& in, ResonatorSnapshot& s) {
+	size_t pos = 0;
+	uint32_t magic, version, voices;
+	if (!getU32(in, pos, magic) || magic != SnapshotMagic) return false;
+	if (!getU32(in, pos, version) || version != SnapshotVersion) return false;
+	if (!getU32(in, pos, voices) || voices > uni_chans) return false;
+	if (!getFloat(in, pos, s.sample_rate)) return false;
+	s.voices = voices;
+
+	for (int ch = 0; ch < s.voices; ch++) {
+		if (!getFloat(in, pos, s.last_delay_out[ch])) return false;
+		for (int i = 0; i < 2; i++) {
+			if (!getFloat(in, pos, s.filter_x[ch][i])) return false;
+			if (!getFloat(in, pos, s.filter_y[ch][i])) return false;
+			if (!getFloat(in, pos, s.dc_block_x[ch][i])) return false;
+			if (!getFloat(in, pos, s.dc_block_y[ch][i])) return false;
+		}
+		uint32_t length;
+		if (!getU32(in, pos, length) || length > BufferLength || pos + 4 * length > in.size()) return false;
+		s.samples[ch].resize(length);
+		s.lengths[ch] = length;
+		std::memcpy(s.samples[ch].data(), &in[pos], 4 * length);
+		pos += 4 * length;
+	}
+	return true;
+}
+
+// a copy with only the captured samples, for the A / B slots
+static ResonatorSnapshot* trimSnapshot(const ResonatorSnapshot& s) {
+	ResonatorSnapshot* trimmed = new ResonatorSnapshot;
+	trimmed->voices = s.voices;
+	trimmed->sample_rate = s.sample_rate;
+	std::memcpy(trimmed->lengths, s.lengths, sizeof(s.lengths));
+	std::memcpy(trimmed->last_delay_out, s.last_delay_out, sizeof(s.last_delay_out));
+	std::memcpy(trimmed->filter_x, s.filter_x, sizeof(s.filter_x));
+	std::memcpy(trimmed->filter_y, s.filter_y, sizeof(s.filter_y));
+	std::memcpy(trimmed->dc_block_x, s.dc_block_x, sizeof(s.dc_block_x));
+	std::memcpy(trimmed->dc_block_y, s.dc_block_y, sizeof(s.dc_block_y));
+	for (int ch = 0; ch < s.voices; ch++) trimmed->samples[ch].assign(s.samples[ch].begin(), s.samples[ch].begin() + s.lengths[ch]);
+	return trimmed;
+}
+
+// resample the stored lines so the ringing tails keep their pitch at another sample rate
+static void resampleSnapshot(ResonatorSnapshot& s, float sample_rate) {
+	double ratio = (double)sample_rate / s.sample_rate;
+	for (int ch = 0; ch < s.voices; ch++) {
+		int length = s.lengths[ch];
+		int new_length = std::min((int)std::ceil(length * ratio), BufferLength);
+		if (length < 2 || new_length < 2) continue;
+
+		std::vector<float> resampled(new_length);
+		SRC_DATA data = {};
+		data.data_in = s.samples[ch].data();
+		data.input_frames = length;
+		data.data_out = resampled.data();
+		data.output_frames = new_length;
+		data.src_ratio = ratio;
+		data.end_of_input = 1;
+		if (src_simple(&data, SRC_SINC_FASTEST, 1) != 0) continue;
+
+		resampled.resize(data.output_frames_gen);
+		s.samples[ch].swap(resampled);
+		s.lengths[ch] = data.output_frames_gen;
+	}
+	s.sample_rate = sample_rate;
+}
+
+
+
+
+// Body Convolver: convolves the stereo output with an impulse response (instrument body)
+
+
+// zero latency non-uniformly partitioned convolution: the first BodyBlock taps run in direct form, the taps up to
+// 2 * BodyLongBlock as partitions of BodyBlock taps in the frequency domain (overlap-save with fft size 2 * BodyBlock),
+// the rest as partitions of BodyLongBlock taps. a long block is due BodyLongBlock samples after its input is complete,
+// so its work is spread over the short blocks in between and every engine block carries about the same load.
+// the cost per block is fixed by the IR length.
+#define BodyBlock (128)
+#define BodyLongBlock (1024)
+#define BodySteps (BodyLongBlock / BodyBlock)
+#define BodyMaxSeconds (3.f)
+
+struct BodyConvolver {
+	dsp::RealFFT fft, long_fft;
+	int channels = 1;
+	int partitions = 0, long_partitions = 0;
+	int pos = 0;
+
+	// per IR channel: head taps in reverse order and the spectra of the tail partitions
+	alignas(16) float head[2][BodyBlock] = {};
+	std::vector<float> spectra[2];
+
+	// per output channel: input history written twice (so the head always reads BodyBlock contiguous samples),
+	// last two input blocks, ring of input block spectra (frequency delay line) and the tail output of the current block
+	alignas(16) float history[2][2 * BodyBlock] = {};
+	alignas(16) float blocks[2][2 * BodyBlock] = {};
+	std::vector<float> fdl[2];
+	int fdl_pos = 0;
+	alignas(16) float tail[2][BodyBlock] = {};
+
+	alignas(16) float spectrum[2 * BodyBlock] = {};
+	alignas(16) float result[2 * BodyBlock] = {};
+
+	// the same for the long partitions. long_step counts the short blocks of the running long block, the spectrum of the
+	// previous long block is accumulated meanwhile and its output comes out during the next one
+	std::vector<float> long_spectra[2];
+	alignas(16) float long_blocks[2][2 * BodyLongBlock] = {};
+	std::vector<float> long_fdl[2];
+	int long_fdl_pos = 0, long_step = 0;
+	alignas(16) float long_accum[2][2 * BodyLongBlock] = {};
+	alignas(16) float long_tail[2][BodyLongBlock] = {};
+	alignas(16) float long_result[2 * BodyLongBlock] = {};
+
+	BodyConvolver() : fft(2 * BodyBlock), long_fft(2 * BodyLongBlock) {}
+
+	// ir holds one or two channels of equal length at the engine sample rate
+	void setImpulseResponse(const std::vector<float>* ir, int irChannels) {
+		channels = irChannels;
+		int length = ir[0].size();
+		partitions = clamp((length - 1) / BodyBlock, 0, 2 * BodySteps - 1);
+		long_partitions = std::max(0, (length - 1) / BodyLongBlock - 1);
+
+		for (int c = 0; c < channels; c++) {
+			for (int k = 0; k < BodyBlock; k++) {
+				head[c][BodyBlock - 1 - k] = (k < length) ? ir[c][k] : 0.f;
+			}
+
+			spectra[c].assign(partitions * 2 * BodyBlock, 0.f);
+			for (int p = 0; p < partitions; p++) {
+				std::fill(spectrum, spectrum + 2 * BodyBlock, 0.f);
+				for (int k = 0; k < BodyBlock; k++) {
+					int tap = (p + 1) * BodyBlock + k;
+					if (tap < length) spectrum[k] = ir[c][tap];
+				}
+				fft.rfft(spectrum, &spectra[c][p * 2 * BodyBlock]);
+			}
+
+			// long partition q covers taps (q + 2) * BodyLongBlock onwards
+			std::vector<float> taps(2 * BodyLongBlock);
+			long_spectra[c].assign(long_partitions * 2 * BodyLongBlock, 0.f);
+			for (int q = 0; q < long_partitions; q++) {
+				std::fill(taps.begin(), taps.end(), 0.f);
+				for (int k = 0; k < BodyLongBlock; k++) {
+					int tap = (q + 2) * BodyLongBlock + k;
+					if (tap < length) taps[k] = ir[c][tap];
+				}
+				long_fft.rfft(taps.data(), &long_spectra[c][q * 2 * BodyLongBlock]);
+			}
+		}
+
+		for (int c = 0; c < 2; c++) {
+			fdl[c].assign(partitions * 2 * BodyBlock, 0.f);
+			long_fdl[c].assign(long_partitions * 2 * BodyLongBlock, 0.f);
+		}
+	}
+
+	void process(float& left, float& right) {
+		float in[2] = {left, right};
+		float out[2];
+
+		for (int c = 0; c < 2; c++) {
+			history[c][pos] = in[c];
+			history[c][pos + BodyBlock] = in[c];
+			blocks[c][BodyBlock + pos] = in[c];
+
+			// direct form head over the last BodyBlock inputs plus the precalculated tail
+			const float* h = head[std::min(c, channels - 1)];
+			const float* x = &history[c][pos + 1];
+			float sum = 0.f;
+			for (int k = 0; k < BodyBlock; k++) sum += h[k] * x[k];
+			out[c] = sum + tail[c][pos] + long_tail[c][long_step * BodyBlock + pos];
+		}
+
+		left = out[0];
+		right = out[1];
+
+		if (++pos == BodyBlock) {
+			pos = 0;
+			processBlock();
+		}
+	}
+
+	// a full input block is in: add its spectrum to the delay line and calculate the tail for the next block
+	void processBlock() {
+		if (long_partitions > 0) processLongStep();
+		if (partitions == 0) return;
+		if (++fdl_pos >= partitions) fdl_pos = 0;
+
+		for (int c = 0; c < 2; c++) {
+			fft.rfft(blocks[c], &fdl[c][fdl_pos * 2 * BodyBlock]);
+
+			// partition p covers taps (p + 1) * BodyBlock onwards, so it meets the input spectrum p blocks older than the newest
+			std::fill(spectrum, spectrum + 2 * BodyBlock, 0.f);
+			const float* h = spectra[std::min(c, channels - 1)].data();
+			for (int p = 0; p < partitions; p++) {
+				int slot = fdl_pos - p;
+				if (slot < 0) slot += partitions;
+				multiplyAccumulate(&h[p * 2 * BodyBlock], &fdl[c][slot * 2 * BodyBlock], spectrum, BodyBlock);
+			}
+
+			// overlap-save: the second half of the inverse transform is the valid output
+			fft.irfft(spectrum, result);
+			for (int k = 0; k < BodyBlock; k++) tail[c][k] = result[BodyBlock + k] * (1.f / (2 * BodyBlock));
+
+			std::copy(blocks[c] + BodyBlock, blocks[c] + 2 * BodyBlock, blocks[c]);
+		}
+	}
+
+	// one short block of the long partitions: the spectrum of a completed long block goes into the delay line at the first
+	// step, every step accumulates its share of the partitions and the last one turns the sum into the next long tail
+	void processLongStep() {
+		int share = (long_partitions + BodySteps - 1) / BodySteps;
+		int first = long_step * share, last = std::min(first + share, long_partitions);
+		if (long_step == 0 && ++long_fdl_pos >= long_partitions) long_fdl_pos = 0;
+
+		for (int c = 0; c < 2; c++) {
+			if (long_step == 0) {
+				long_fft.rfft(long_blocks[c], &long_fdl[c][long_fdl_pos * 2 * BodyLongBlock]);
+				std::copy(long_blocks[c] + BodyLongBlock, long_blocks[c] + 2 * BodyLongBlock, long_blocks[c]);
+			}
+			std::copy(blocks[c] + BodyBlock, blocks[c] + 2 * BodyBlock, long_blocks[c] + BodyLongBlock + long_step * BodyBlock);
+
+			const float* h = long_spectra[std::min(c, channels - 1)].data();
+			for (int q = first; q < last; q++) {
+				int slot = long_fdl_pos - q;
+				if (slot < 0) slot += long_partitions;
+				multiplyAccumulate(&h[q * 2 * BodyLongBlock], &long_fdl[c][slot * 2 * BodyLongBlock], long_accum[c], BodyLongBlock);
+			}
+
+			if (long_step == BodySteps - 1) {
+				long_fft.irfft(long_accum[c], long_result);
+				for (int k = 0; k < BodyLongBlock; k++) long_tail[c][k] = long_result[BodyLongBlock + k] * (1.f / (2 * BodyLongBlock));
+				std::fill(long_accum[c], long_accum[c] + 2 * BodyLongBlock, 0.f);
+			}
+		}
+
+		if (++long_step == BodySteps) long_step = 0;
+	}
+
+	// complex multiply-add in the ordered real fft format: [dc, nyquist, re1, im1, re2, im2, ...]
+	static void multiplyAccumulate(const float* a, const float* b, float* acc, int block) {
+		acc[0] += a[0] * b[0];
+		acc[1] += a[1] * b[1];
+		for (int k = 2; k < 2 * block; k += 2) {
+			acc[k] += a[k] * b[k] - a[k + 1] * b[k + 1];
+			acc[k + 1] += a[k] * b[k + 1] + a[k + 1] * b[k];
+		}
 	}
 };
 
-struct SmallLuggezKnob : RoundKnob {
-	SmallLuggezKnob() {
-		setSvg(APP->window->loadSvg(asset::plugin(pluginInstance, "res/SmallLuggezKnob.svg")));
+// read a wav file (16/24/32 bit pcm or 32 bit float) into at most two channels
+static bool loadWav(const std::string& path, std::vector<float>* channels, int& channelCount, float& sampleRate) {
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (!file) return false;
+	std::vector<uint8_t> data;
+	uint8_t chunk[4096];
+	size_t n;
+	while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + n);
+	std::fclose(file);
+
+	if (data.size() < 12 || std::memcmp(&data[0], "RIFF", 4) || std::memcmp(&data[8], "WAVE", 4)) return false;
+
+	int format = 0, fileChannels = 0, bits = 0;
+	size_t pos = 12;
+	while (pos + 8 <= data.size()) {
+		uint32_t size;
+		size_t sizePos = pos + 4;
+		getU32(data, sizePos, size);
+		size_t body = pos + 8;
+		if (body + size > data.size()) size = data.size() - body;
+
+		if (!std::memcmp(&data[pos], "fmt ", 4) && size >= 16) {
+			format = data[body] | (data[body + 1] << 8);
+			fileChannels = data[body + 2] | (data[body + 3] << 8);
+			uint32_t rate = 0;
+			size_t ratePos = body + 4;
+			getU32(data, ratePos, rate);
+			sampleRate = rate;
+			bits = data[body + 14] | (data[body + 15] << 8);
+			// WAVE_FORMAT_EXTENSIBLE keeps the actual format in the sub format guid
+			if (format == 0xfffe && size >= 26) format = data[body + 24] | (data[body + 25] << 8);
+		}
+		else if (!std::memcmp(&data[pos], "data", 4) && fileChannels > 0) {
+			int bytes = bits / 8;
+			if (!((format == 1 && (bytes == 2 || bytes == 3 || bytes == 4)) || (format == 3 && bytes == 4))) return false;
+
+			channelCount = std::min(fileChannels, 2);
+			int frames = size / (bytes * fileChannels);
+			for (int c = 0; c < channelCount; c++) channels[c].resize(frames);
+
+			for (int i = 0; i < frames; i++) {
+				for (int c = 0; c < channelCount; c++) {
+					const uint8_t* p = &data[body + (i * fileChannels + c) * bytes];
+					float v;
+					if (format == 3) {
+						std::memcpy(&v, p, 4);
+					} else if (bytes == 2) {
+						v = int16_t(p[0] | (p[1] << 8)) / 32768.f;
+					} else if (bytes == 3) {
+						v = int32_t((uint32_t(p[0]) << 8) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 24)) / 2147483648.f;
+					} else {
+						v = int32_t(uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24)) / 2147483648.f;
+					}
+					channels[c][i] = v;
+				}
+			}
+			return frames > 0 && sampleRate > 0.f;
+		}
+		pos = body + size + (size & 1);
 	}
+	return false;
+}
+
+
+
+
+// Voice Struct: everything one voice touches per sample, kept together and cache line aligned
+
+
+struct alignas(64) AlaeVoice {
+	int write = 0;
+	bool in_pool = false;
+	// 32.32 fixed point read position and delay. after the update in process read_phase = (write << 32) - delay_phase,
+	// so it starts one sample behind write and the first update lands on the same position as the multi-tap taps
+	uint64_t read_phase = uint64_t(0) - PhaseOne, delay_phase = 0;
+	// delay in samples and its loop compensation stay double up to the read phase, a float delay of 2^19 samples would only
+	// resolve 1/32 sample
+	double index = 0.0, delay_comp = 0.0;
+	float decay = 0.f;
+	float delay_in = 0.f, delay_out = 0.f, last_delay_out = 0.f, allpass_state = 0.f;
+	dsp::BiquadFilter filter;
+	dsp::BiquadFilter dc_block;
+	int excite_count = 0;
+
+	// modulation values, recalculated every sample
+	float tune = 0.f, freq = 0.f, t60 = 0.f, filter_freq = 0.f, filter_norm = 0.f, dc_block_freq = 0.f;
+
+	// last coefficient inputs, so filters and delay compensation only get recalculated on changes
+	float filter_freq_last = 0.f, filter_res_last = 0.f, dc_block_freq_last = 0.f, comp_freq = 0.f;
+	int filter_type_last = 0;
+	bool comp_dirty = false;
+
+	// samples written since the line was reset or left unused in multi-tap mode. older ones get settled right before they are
+	// read: from the shared line after multi-tap mode, otherwise to silence and the noise burst of burst samples before burst_end
+	int fresh = BufferLength;
+	bool stale_shared = false;
+	int burst = 0, burst_end = 0;
+	uint32_t burst_seed = 0;
 };
 
 
@@ -39,75 +449,31 @@ struct SmallLuggezKnob : RoundKnob {
 // Module Struct: Params, Inputs, Outputs & Lights
 
 
-struct Alae : Module {
-	enum ParamId {
-		ATT_TUNE_TRCK,
-		ATT_TUNE_FM,
-		PRM_TUNE,
-		PRM_FINE_TUNE,
-		ATT_TUNE_SPRD,
-		PRM_TUNE_SPRD,
-		PRM_VOX_COUNT,
-		ATT_FLTR_FREQ,
-		PRM_FLTR_FREQ,
-		ATT_FLTR_SPRD,
-		PRM_FLTR_SPRD,
-		ATT_FLTR_RES,
-		PRM_FLTR_RES,
-		ATT_DEC,
-		PRM_DEC,
-		ATT_FB,
-		PRM_FB,
-		PRM_VCA,
-		ATT_DRYWET,
-		PRM_DRYWET,
-		ATT_FB_IN,
-		BTN_TYPE,
-		BTN_KEYTRACK,
-		PARAMS_LEN
-	};
-	enum InputId {
-		IN_TUNE_1VOCT,
-		IN_TUNE_FM,
-		IN_TUNE_SPRD,
-		IN_FLTR_FREQ,
-		IN_FLTR_SPRD,
-		IN_FLTR_RES,
-		IN_DEC,
-		IN_FB,
-		IN_VCA,
-		IN_DRYWET,
-		IN_AUDIO,
-		IN_AUDIO_FB,
-		INPUTS_LEN
-	};
-	enum OutputId {
-		OUT_AUDIO_LEFT,
-		OUT_AUDIO_RIGHT,
-		OUTPUTS_LEN
-	};
-	enum LightId {
-		LGHT_LP,
-		LGHT_BP,
-		LGHT_HP,
-		LGHT_NO,
-		LGHT_TYPE,
-		LGHT_KEYTRACK,
-		LIGHTS_LEN
-	};
-
-	// init filters and triggers inside module to ensure they arent shared accross multiple instances
-
-	std::vector<dsp::BiquadFilter> filters;
-    std::vector<dsp::BiquadFilter> dc_block;
+struct Alae : Module, AlaeIds {
+
+	// init triggers inside module to ensure they arent shared accross multiple instances
+
     dsp::BooleanTrigger a_type_trigger;
     dsp::BooleanTrigger a_keytrack_trigger;
     dsp::BooleanTrigger a_tune_sprd_trigger;
     dsp::BooleanTrigger a_fltr_sprd_trigger;
+    dsp::SchmittTrigger a_gate_trigger;
+
+	// the voices are cache line aligned, but c++11 new only guarantees 16 bytes - over-allocate and align by hand
+	static void* operator new(size_t size) {
+		uint8_t* raw = static_cast<uint8_t*>(::operator new(size + 64));
+		uint8_t* aligned = raw + 64 - (reinterpret_cast<uintptr_t>(raw) & 63);
+		reinterpret_cast<uint8_t**>(aligned)[-1] = raw;
+		return aligned;
+	}
 
-    // module contructor. setting the channel count for filters and dc_block
+	static void operator delete(void* p) {
+		if (p) ::operator delete(reinterpret_cast<uint8_t**>(p)[-1]);
+	}
+
+    // module contructor
     
-	Alae() :  filters(uni_chans), dc_block(uni_chans)  {
+	Alae() {
 
 		// config Params Inputs and Outputs
 
@@ -152,34 +518,63 @@ struct Alae : Module {
 		configInput(IN_VCA, "VCA");
 		configInput(IN_DRYWET, "DRY / WET");
 		configInput(IN_AUDIO_FB, "External Feedback Input");
+		configInput(IN_GATE, "Gate / Retrigger");
 		
 		configInput(IN_AUDIO, "");
 		
 		configOutput(OUT_AUDIO_LEFT, "");
 		configOutput(OUT_AUDIO_RIGHT, "");
 
+		// precalculate the sample rate dependent constants, the engine sends an event whenever the rate changes
+		setSampleRate(APP->engine->getSampleRate());
+	}
+
+	// the engine doesnt process the module anymore, so all body convolvers can go
+	~Alae() {
+		if (a_body_thread.joinable()) a_body_thread.join();
+		delete a_body;
+		delete a_body_pending.load();
+		delete a_body_retired.load();
+		delete a_transfer;
+		delete a_recall.load();
+		delete a_recalled.load();
+		delete a_capture.load();
+		delete a_captured.load();
 	}
 
 	// init variables
 	
 
 
-	float buffers[uni_chans][BufferLength] = {};
-	float audio_in, audio_out_left, audio_out_right, delay_out[uni_chans], last_delay_out[uni_chans], delay_in[uni_chans];
-	float a_tune[uni_chans], a_freq[uni_chans], a_filter_freq[uni_chans];
-	float a_filter_res, a_t60[uni_chans], a_decay[uni_chans], a_phase, a_feedback, a_vca_mod, a_mix, a_base_freq;
-	float a_base_freq_norm, a_filter_norm[uni_chans], a_base_tune, a_spread_tune, a_spread_filter;
-	float a_dc_block_freq[uni_chans];
+	// hot per voice state first, the 16 MB of delay lines come last
+	AlaeVoice voices[uni_chans];
+
+	float audio_in, audio_out_left, audio_out_right;
+	float a_filter_res, a_phase, a_feedback, a_vca_mod, a_mix, a_base_freq;
+	float a_base_freq_norm, a_base_tune, a_spread_tune, a_spread_filter;
 	float a_filter_freq_min = 30.f;
 	float a_filter_freq_max = 20000.f;
 
+	// sample rate dependent constants, only updated in onSampleRateChange
+	float a_sample_rate = 44100.f, a_sample_time = 1.f / 44100.f, a_nyquist = 22050.f, a_angular_time = 2.f * M_PI / 44100.f;
+	float a_lowest_pitch = 0.f;
+
+	// resample the ringing delay lines when the sample rate changes
+	int a_resample_state = 1;
+
+	// delay mode: 0 = separate lines, 1 = multi-tap on one shared line, 2 = multi-tap in the delay tuning range only
+	int a_delay_mode = 0;
+	bool a_multitap_last = false;
+	float a_tap_feedback = 0.f;
+
+	// retrigger excitation: 0 = choke only, 1 = noise burst, 2 = input signal
+	int a_excite_mode = 1;
+
 	// init spread factors
 
 	float a_harmonic_spread[uni_chans] = {-3.5f, -2.5f, -1.5f, -0.5f, 0.5f, 1.5f, 2.5f, 3.5f};
 	float a_inharm_factor[uni_chans] = {0.8375f, 0.1923f, 0.5234f, 0.6152f, 0.4032f, 0.9948f, 0.2345f, 0.7812f}; 
 
-	float a_index[uni_chans], a_read[uni_chans];
-	int a_write[uni_chans];
 	int activeChannels = 1;
 	int a_type = 1;
 	int a_keytrack = 1;
@@ -192,12 +587,82 @@ struct Alae : Module {
 	// init interpolation to linear
 	int InterpolationSelect = 1;
 
+	// automatic loop delay compensation
+	int a_loop_comp = 1;
+
+	// resonator state snapshots: saved with the patch if enabled, A/B slots for live recall
+	int a_store_state = 0;
+	std::unique_ptr<ResonatorSnapshot> a_snapshot_slots[2];
+
+	// UI side of the captures: the latest finished one for saving, the buffer for the next one and a pending A / B store
+	std::unique_ptr<ResonatorSnapshot> a_state_latest, a_state_spare;
+	bool a_capture_running = false;
+	int a_store_slot = -1;
+	std::chrono::steady_clock::time_point a_capture_time;
+
+	// the engine holds its lock during a sample rate change, so the event only leaves the new rate and a body reload here.
+	// the audio thread keeps the old constants until the UI thread has captured the tails, resampled them and recalled them,
+	// so the tails never mix samples of both rates. without a UI the new rate takes over after a second
+	std::atomic<float> a_rate_pending {0.f};
+	std::atomic<bool> a_rate_request {false}, a_body_reload {false};
+	int a_rate_wait = 0;
+	bool a_processing = false;
+	bool a_resample_wanted = false, a_resample_capture = false;
+
+	// captures and recalls run on the audio thread, TransferChunk samples per voice and call. the UI hands over a snapshot
+	// through a_capture / a_recall and gets it back through a_captured / a_recalled, the running one belongs to the audio thread
+	std::atomic<ResonatorSnapshot*> a_recall {nullptr}, a_recalled {nullptr};
+	std::atomic<ResonatorSnapshot*> a_capture {nullptr}, a_captured {nullptr};
+	ResonatorSnapshot* a_transfer = nullptr;
+	bool a_transfer_capture = false;
+	int a_transfer_done = 0;
+	int a_transfer_start[uni_chans] = {}, a_transfer_length[uni_chans] = {};
+	static_assert(ATOMIC_POINTER_LOCK_FREE == 2 && ATOMIC_BOOL_LOCK_FREE == 2, "the snapshot handshake must not lock on the audio thread");
+
+	// optional worst case process time in microseconds, catches spikes that the average cpu meter hides
+	int a_measure_time = 0;
+	std::atomic<float> a_peak_time {0.f};
+
+	// output body stage. a_body is only touched by the audio thread, new convolvers come in through a_body_pending
+	// and replaced ones go out through a_body_retired, where the UI thread deletes them
+	// the IR is copied into the patch storage, a_body_file only keeps the original file name for the menu. a fixed buffer,
+	// so loading a patch under the engine lock doesnt allocate
+	char a_body_file[256] = "";
+	std::thread a_body_thread;
+	bool a_added = false;
+	BodyConvolver* a_body = nullptr;
+	std::atomic<BodyConvolver*> a_body_pending {nullptr};
+	std::atomic<BodyConvolver*> a_body_retired {nullptr};
+	std::atomic<bool> a_body_clear {false};
+
+	// delay lines: a small pool for the newest samples of short (high pitched) voices and the full length buffers. the pool
+	// interleaves the voices, one row per position, so voices at the same position share a cache line. a voice writes to one
+	// of them only
+	alignas(64) float a_short_pool[ShortLength][uni_chans] = {};
+	float buffers[uni_chans][BufferLength] = {};
+
 	// proces function
+	// the audio thread path: no allocations, locks or system calls in here or in the functions it calls
 	void process(const ProcessArgs& args) override {   
 
+		std::chrono::steady_clock::time_point process_start;
+		if (a_measure_time) process_start = std::chrono::steady_clock::now();
+
 		// get the active channel count from the VOX param
 		activeChannels = int((params[PRM_VOX_COUNT].getValue()));
 
+		// start the next snapshot transfer once the UI has collected the last result, and copy the next chunk of the running one
+		if (!a_transfer) {
+			if (a_capture.load(std::memory_order_relaxed) && !a_captured.load()) startTransfer(a_capture.exchange(nullptr), true);
+			else if (a_recall.load(std::memory_order_relaxed) && !a_recalled.load()) startTransfer(a_recall.exchange(nullptr), false);
+		}
+		if (a_transfer) continueTransfer();
+
+		// a pending sample rate change waits for the recall of the resampled tails, see onSampleRateChange
+		a_processing = true;
+		float rate_pending = a_rate_pending.load(std::memory_order_relaxed);
+		if (rate_pending > 0.f && ++a_rate_wait > rate_pending) applyPendingRate();
+
 		// read audio input and add attenuated external feedback
 		audio_in = inputs[IN_AUDIO].getVoltage() + (inputs[IN_AUDIO_FB].getVoltage() * params[ATT_FB_IN].getValue());
 
@@ -218,9 +683,12 @@ struct Alae : Module {
 
 		// apply noise for self oscillation if input is not connected
 		if (!inputs[IN_AUDIO].isConnected()) {
-			audio_in += (a_feedback - 1) * ((rand() % 100) * 0.000001f); // apply noise to self oscillate
+			audio_in += (a_feedback - 1) * (random::uniform() * 0.0001f); // apply noise to self oscillate - rack's thread local generator, rand() would take a lock
 		}
 
+		// choke and retrigger the resonators on a rising gate, once each voice knows the pitch of this sample
+		bool retrigger = a_gate_trigger.process(inputs[IN_GATE].getVoltage());
+
 		// reset audio outputs  to fill in with new added samples in the loop
 		audio_out_left = 0;
 		audio_out_right = 0;  
@@ -239,15 +707,13 @@ struct Alae : Module {
 		if (a_keytrack_trigger.process(params[BTN_KEYTRACK].getValue())) a_keytrack++;
 		if (a_keytrack > 1) a_keytrack = 0;
 		
-		// calculate lowest possible pitch 1VOct factor - calculation based on sample rate
-		float lowest_pitch = std::log2((args.sampleRate / BufferLength) / dsp::FREQ_C4); 
-
 		// split tuning knob in audio and delay range
 		a_base_tune = params[PRM_TUNE].getValue() + (params[PRM_FINE_TUNE].getValue() * 0.01); // read pitch param + fine tune
+		bool in_delay_range = a_base_tune < 0.f;
 		if (a_base_tune >= 0.f) {
 			a_base_tune = rack::math::rescale(a_base_tune, 0.f, 1.f, -3.3f, 4.5f); // audible tuning range
 		} else {
-			a_base_tune = rack::math::rescale(a_base_tune, -1.f, 0.f, lowest_pitch, -3.3f); // delay tuning range based on lowest possible pitch
+			a_base_tune = rack::math::rescale(a_base_tune, -1.f, 0.f, a_lowest_pitch, -3.3f); // delay tuning range based on lowest possible pitch
 		}
 
 		// add 1V Oct input
@@ -274,95 +740,161 @@ struct Alae : Module {
 
 
 
+		// multi-tap mode: the voices become read taps on the delay line of voice 0, which is fed by one shared feedback path
+		bool multitap = (a_delay_mode == 1) || (a_delay_mode == 2 && in_delay_range);
+
+		// leaving multi-tap mode: the unused lines of the other voices are stale. clearing them here would choke the taps and
+		// could touch megabytes in one sample, so they get filled lazily from the shared line instead
+		if (a_multitap_last && !multitap) {
+			for (int ch = 1; ch < uni_chans; ch++) {
+				voices[ch].fresh = 0;
+				voices[ch].stale_shared = true;
+			}
+		}
+		a_multitap_last = multitap;
+
+		// taps read relative to the write position of the shared line before it advances
+		int shared_write = voices[0].write;
+		float tap_feedback = 0.f;
+
 		// delay line processing for the active channels
 		for (int ch = 0; ch < activeChannels; ch++) {
 
 			// transfer the base tuning to the processing loop
-			a_tune[ch] = a_base_tune; 
+			voices[ch].tune = a_base_tune; 
 
 			// apply spread to the base tuning for each voice
 			if (activeChannels % 2 == 1 and ch == 0){
 				// keep channel 0 at base_freq for odd voice counts	
-				a_tune[ch] = a_tune[ch];
+				voices[ch].tune = voices[ch].tune;
 
 			// distrubute the alternating pitches to the other channels		
 			} else {
 				if (ch % 2 == 0) {
-					a_tune[ch] += a_spread_tune * (a_harmonic_spread[ch] * ((a_tune_sprd_mode == 1) ? a_inharm_factor[ch] : 1.0f));
+					voices[ch].tune += a_spread_tune * (a_harmonic_spread[ch] * ((a_tune_sprd_mode == 1) ? a_inharm_factor[ch] : 1.0f));
 				} else {
-					a_tune[ch] += a_spread_tune * (a_harmonic_spread[uni_chans - ch] * ((a_tune_sprd_mode == 1) ? a_inharm_factor[uni_chans - ch] : 1.0f));	
+					voices[ch].tune += a_spread_tune * (a_harmonic_spread[uni_chans - ch] * ((a_tune_sprd_mode == 1) ? a_inharm_factor[uni_chans - ch] : 1.0f));	
 				} 
 			}
 
 			// apply attenuated pitch modulation input to each channel
-			a_tune[ch] += inputs[IN_TUNE_FM].getVoltage() * params[ATT_TUNE_FM].getValue(); 
-			a_tune[ch] = clamp(a_tune[ch], lowest_pitch, 8.f);
+			voices[ch].tune += inputs[IN_TUNE_FM].getVoltage() * params[ATT_TUNE_FM].getValue(); 
+			voices[ch].tune = clamp(voices[ch].tune, a_lowest_pitch, 8.f);
 
 			// calculate frequency in hz
-			a_freq[ch] = dsp::FREQ_C4 * std::pow(2.f, a_tune[ch]);  
+			voices[ch].freq = dsp::FREQ_C4 * std::pow(2.f, voices[ch].tune);  
+
+			// calculate index in samples, from the pitch in double and not from the float frequency
+			voices[ch].index = a_sample_rate / (dsp::FREQ_C4 * std::pow(2.0, (double)voices[ch].tune));
+
+			// voices that only need a short ring run in the short pool, decided on this samples delay before anything is read
+			// (with hysteresis, entering and leaving copy one pool length). the shared multi-tap line stays out, its longest tap is
+			// only known after the loop, and so does every voice while a snapshot transfer works on the full length buffers
+			if (multitap) leavePool(ch);
+			else if (!voices[ch].in_pool && !a_transfer && activeLength(ch) <= ShortLength / 2) enterPool(ch);
+			else if (voices[ch].in_pool && activeLength(ch) > ShortLength) leavePool(ch);
 
-			// calculate index in samples
-			a_index[ch] = args.sampleRate / a_freq[ch]; 
+			// the reset region and the burst are exactly one period of the new note
+			if (retrigger && !multitap) retriggerVoice(ch);
 
 			
 			// read decay param and apply attenuated cv input
-			a_decay[ch] = params[PRM_DEC].getValue() + rack::math::rescale(inputs[IN_DEC].getVoltage(), -5.f, 5.f, -1.f, 1.f) * params[ATT_DEC].getValue(); 
+			voices[ch].decay = params[PRM_DEC].getValue() + rack::math::rescale(inputs[IN_DEC].getVoltage(), -5.f, 5.f, -1.f, 1.f) * params[ATT_DEC].getValue(); 
 			// scale decay exponentially for precise control over smaller values
-			a_decay[ch] = 0.f + (60.f - 0.f) * pow(a_decay[ch], 4.f); 
+			voices[ch].decay = 0.f + (60.f - 0.f) * pow(voices[ch].decay, 4.f); 
 			// calculate a decay fator for each channel based on the pitch
-			a_t60[ch] = args.sampleRate * abs(a_decay[ch]) / a_index[ch];
-			a_decay[ch] = pow(10, -3 / a_t60[ch]) * a_phase;
+			voices[ch].t60 = a_sample_rate * abs(voices[ch].decay) / voices[ch].index;
+			voices[ch].decay = pow(10, -3 / voices[ch].t60) * a_phase;
 			// clamp decay factor to stay < 1 
-			a_decay[ch] = clamp (a_decay[ch], -0.99999f, 0.99999f); 
+			voices[ch].decay = clamp (voices[ch].decay, -0.99999f, 0.99999f); 
 
 			
-			// add last delay sample to form a feedback loop and apply feedback factor
-			delay_in[ch] = audio_in + last_delay_out[ch] * a_decay[ch];
+			// with input excitation and a connected gate the input only reaches the loop for one period after each trigger
+			float voice_in = audio_in;
+			if (a_excite_mode == 2 && inputs[IN_GATE].isConnected()) {
+				voice_in = (voices[ch].excite_count > 0) ? audio_in : 0.f;
+				if (voices[ch].excite_count > 0) voices[ch].excite_count--;
+			}
+
+			// add last delay sample to form a feedback loop and apply feedback factor. in multi-tap mode all taps feed back together
+			if (multitap) {
+				voices[ch].delay_in = voice_in + a_tap_feedback;
+			} else {
+				voices[ch].delay_in = voice_in + voices[ch].last_delay_out * voices[ch].decay;
+			}
 
-			// write input to buffer
-			buffers[ch][a_write[ch]] = delay_in[ch];
+			// the delay line this voice writes and reads
+			int line = multitap ? 0 : ch;
 
-			// read position for the buffer
-			a_read[ch] = a_write[ch] - a_index[ch] - params[ATT_TUNE_TRCK].getValue(); 
+			// pool and buffer positions are the same modulo ShortLength, in the pool the samples of a voice are uni_chans apart
+			float* buffer = voices[line].in_pool ? &a_short_pool[0][line] : buffers[line];
+			int mask = (voices[line].in_pool ? ShortLength : BufferLength) - 1;
+			int stride = voices[line].in_pool ? uni_chans : 1;
 
-			// correct the buffer index if the buffer is run to its end - circular buffer
-			if (a_read[ch]<0) a_read[ch] += BufferLength; 
+			// write input to the pool or the buffer
+			if (ch == line) {
+				writeSample(ch, voices[ch].write, voices[ch].delay_in);
+				if (voices[ch].fresh < BufferLength) voices[ch].fresh++;
+			}
+
+			// delay length in samples. the loop filter, the dc blocker and the feedback sample already delay the loop, so subtract it to stay in tune
+			double delay_length = voices[ch].index;
+			if (a_loop_comp == 1) delay_length = std::max(delay_length - voices[ch].delay_comp, 2.0);
+
+			// advance the fixed point read phase by one sample minus the change of the delay. integer math keeps the full
+			// 32 bit fraction even at the end of the buffer, where a float position only has 1/32 sample resolution
+			uint64_t delay_phase = (uint64_t)(int64_t)((delay_length + params[ATT_TUNE_TRCK].getValue()) * PhaseOne);
+			voices[ch].read_phase += PhaseOne + voices[ch].delay_phase - delay_phase;
+			voices[ch].delay_phase = delay_phase;
+
+			// taps on the shared line are placed relative to its write position
+			uint64_t read_phase = multitap ? ((uint64_t)shared_write << 32) - delay_phase : voices[ch].read_phase;
+
+			// the integer part indexes the buffer directly, the fraction feeds the interpolators
+			int read = (read_phase >> 32) & mask;
+			float frac = (uint32_t)read_phase * (1.f / PhaseOne);
+
+			// a line that was reset or unused in multi-tap mode settles the samples from before right before reading them
+			if (voices[line].fresh < BufferLength) settleAround(line, read_phase, multitap ? shared_write : voices[ch].write);
 
 
 			// get the interpolated sample value depending on the selected interpolation type
 			switch (InterpolationSelect) {
 				case 1:
-					delay_out[ch] = getInterpolatedSample(a_read[ch], buffers[ch], BufferLength, LINEAR);
+					voices[ch].delay_out = getInterpolatedSample(read, frac, buffer, mask, stride, LINEAR);
 				break;
 				case 2:
-					delay_out[ch] = getInterpolatedSample(a_read[ch], buffers[ch], BufferLength, LAGRANGE);
+					voices[ch].delay_out = getInterpolatedSample(read, frac, buffer, mask, stride, LAGRANGE);
 				break;
 				case 3:
-					delay_out[ch] = getInterpolatedSample(a_read[ch], buffers[ch], BufferLength, CUBIC_SPLINE);
+					voices[ch].delay_out = getInterpolatedSample(read, frac, buffer, mask, stride, CUBIC_SPLINE);
 				break;
 				case 4:
-					delay_out[ch] = getInterpolatedSample(a_read[ch], buffers[ch], BufferLength, QUADRATIC);
+					voices[ch].delay_out = getInterpolatedSample(read, frac, buffer, mask, stride, QUADRATIC);
 				break;
 				case 5:
-					delay_out[ch] = getInterpolatedSample(a_read[ch], buffers[ch], BufferLength, NO_INTERPOLATION);
+					voices[ch].delay_out = getInterpolatedSample(read, frac, buffer, mask, stride, NO_INTERPOLATION);
+				break;
+				case 6:
+					voices[ch].delay_out = getAllpassSample(read, frac, buffer, mask, stride, voices[ch].allpass_state);
 				break;
 			}
 			
  
 
 			// read filter parameter
-			a_filter_freq[ch] = params[PRM_FLTR_FREQ].getValue(); 
+			voices[ch].filter_freq = params[PRM_FLTR_FREQ].getValue(); 
 			// apply attenuated modulation to filter frequency
-			a_filter_freq[ch] += rack::math::rescale(inputs[IN_FLTR_FREQ].getVoltage(), -5.f, 5.f, -1.f, 1.f) * params[ATT_FLTR_FREQ].getValue(); 
+			voices[ch].filter_freq += rack::math::rescale(inputs[IN_FLTR_FREQ].getVoltage(), -5.f, 5.f, -1.f, 1.f) * params[ATT_FLTR_FREQ].getValue(); 
 			
 			// apply keytracking based on the base pitch frequency
 
 			if (a_keytrack == 1) {
-				a_filter_norm[ch] = clamp(a_base_freq_norm + a_filter_freq[ch], -1.f, 1.f); // apply keytrack
+				voices[ch].filter_norm = clamp(a_base_freq_norm + voices[ch].filter_freq, -1.f, 1.f); // apply keytrack
 				lights[LGHT_KEYTRACK].setBrightness(1.f);
 
 			} else {
-				a_filter_norm[ch] = clamp(a_filter_freq[ch], -1.f, 1.f);
+				voices[ch].filter_norm = clamp(voices[ch].filter_freq, -1.f, 1.f);
 				lights[LGHT_KEYTRACK].setBrightness(0.f);
 			}
 
@@ -371,25 +903,25 @@ struct Alae : Module {
 			// apply filter spread
 			if (activeChannels % 2 == 1 and ch == 0){
 				// keep channel 0 at base_freq for odd voice counts		
-				a_filter_norm[ch] = a_filter_norm[ch];
+				voices[ch].filter_norm = voices[ch].filter_norm;
 
 			// alternate spread values between the rest of the channels	
 			} else {
 				if (ch % 2 == 0) {
-					a_filter_norm[ch] += a_spread_filter * (a_harmonic_spread[ch] * ((a_fltr_sprd_mode == 1) ? a_inharm_factor[ch] : 1.0f));
+					voices[ch].filter_norm += a_spread_filter * (a_harmonic_spread[ch] * ((a_fltr_sprd_mode == 1) ? a_inharm_factor[ch] : 1.0f));
 				} else {
-					a_filter_norm[ch] += a_spread_filter * (a_harmonic_spread[uni_chans - ch] * ((a_fltr_sprd_mode == 1) ? a_inharm_factor[uni_chans - ch] : 1.0f));	
+					voices[ch].filter_norm += a_spread_filter * (a_harmonic_spread[uni_chans - ch] * ((a_fltr_sprd_mode == 1) ? a_inharm_factor[uni_chans - ch] : 1.0f));	
 				} 
 			}
 
 			// calculate filter frequency in its actual range
-			a_filter_freq[ch] = std::pow(2.f, std::log2(a_filter_freq_min) + a_filter_norm[ch] * (std::log2(a_filter_freq_max) - std::log2(a_filter_freq_min)));
+			voices[ch].filter_freq = std::pow(2.f, std::log2(a_filter_freq_min) + voices[ch].filter_norm * (std::log2(a_filter_freq_max) - std::log2(a_filter_freq_min)));
 			
 			// calculate filter coeffizient
-			a_filter_freq[ch] = a_filter_freq[ch] / args.sampleRate;  
+			voices[ch].filter_freq = voices[ch].filter_freq * a_sample_time;  
 
 			// clamp filter coeffizient to avoid errors
-			a_filter_freq[ch] = clamp(a_filter_freq[ch], 0.001f, 0.499f);
+			voices[ch].filter_freq = clamp(voices[ch].filter_freq, 0.001f, 0.499f);
 
 			// read resonance param
 			a_filter_res = params[PRM_FLTR_RES].getValue(); 
@@ -407,53 +939,72 @@ struct Alae : Module {
 					lights[LGHT_BP].setBrightness(0.f);
 					lights[LGHT_HP].setBrightness(0.f);
 					lights[LGHT_NO].setBrightness(0.f);
-					filters[ch].setParameters(filters[ch].LOWPASS, a_filter_freq[ch], a_filter_res, 1.0f);
-					delay_out[ch] = filters[ch].process(delay_out[ch]);
+					updateLoopFilter(ch, voices[ch].filter.LOWPASS);
+					voices[ch].delay_out = voices[ch].filter.process(voices[ch].delay_out);
     			break;
     			case 2:
     				lights[LGHT_LP].setBrightness(0.f);
 					lights[LGHT_BP].setBrightness(1.f);
 					lights[LGHT_HP].setBrightness(0.f);
 					lights[LGHT_NO].setBrightness(0.f);
-					filters[ch].setParameters(filters[ch].BANDPASS, a_filter_freq[ch], a_filter_res, 1.0f);
-					delay_out[ch] = filters[ch].process(delay_out[ch]);
+					updateLoopFilter(ch, voices[ch].filter.BANDPASS);
+					voices[ch].delay_out = voices[ch].filter.process(voices[ch].delay_out);
     			break; 
     			case 3:
     				lights[LGHT_LP].setBrightness(0.f);
 					lights[LGHT_BP].setBrightness(0.f);
 					lights[LGHT_HP].setBrightness(1.f);
 					lights[LGHT_NO].setBrightness(0.f);
-					filters[ch].setParameters(filters[ch].HIGHPASS, a_filter_freq[ch], a_filter_res, 1.0f);
-					delay_out[ch] = filters[ch].process(delay_out[ch]);
+					updateLoopFilter(ch, voices[ch].filter.HIGHPASS);
+					voices[ch].delay_out = voices[ch].filter.process(voices[ch].delay_out);
     			break; 
     			case 4:
     				lights[LGHT_LP].setBrightness(0.f);
 					lights[LGHT_BP].setBrightness(0.f);
 					lights[LGHT_HP].setBrightness(0.f);
 					lights[LGHT_NO].setBrightness(1.f);
-					filters[ch].setParameters(filters[ch].NOTCH, a_filter_freq[ch], a_filter_res, 1.0f);
-					delay_out[ch] = filters[ch].process(delay_out[ch]);
+					updateLoopFilter(ch, voices[ch].filter.NOTCH);
+					voices[ch].delay_out = voices[ch].filter.process(voices[ch].delay_out);
     			break;
     			case 5:
     				lights[LGHT_LP].setBrightness(0.f);
 					lights[LGHT_BP].setBrightness(0.f);
 					lights[LGHT_HP].setBrightness(0.f);
 					lights[LGHT_NO].setBrightness(0.f);
+					if (voices[ch].filter_type_last != 5) {
+						voices[ch].filter_type_last = 5;
+						voices[ch].comp_dirty = true;
+					}
     			break;    			
     		}
 
 
 
-			// filter out low frequencys 3 octaves below the channels pitch frequency to prevent low frequency build ups at higher pitches
-    		a_dc_block_freq[ch] = clamp((a_freq[ch] / 3), 10.f, args.sampleRate / 2.f);
-    		dc_block[ch].setParameters(dc_block[ch].HIGHPASS, a_dc_block_freq[ch] / args.sampleRate, 0.701, 1.0f);
-			delay_out[ch] = dc_block[ch].process(delay_out[ch]);
+			// filter out low frequencys 6 octaves below the channels pitch frequency to prevent low frequency build ups at higher pitches.
+			// closer to the pitch its phase lead would stretch the partials apart, which no loop delay compensation can undo
+    		voices[ch].dc_block_freq = clamp((voices[ch].freq / 64), 1.f, a_nyquist);
+    		if (voices[ch].dc_block_freq != voices[ch].dc_block_freq_last) {
+    			voices[ch].dc_block.setParameters(voices[ch].dc_block.HIGHPASS, voices[ch].dc_block_freq * a_sample_time, 0.701, 1.0f);
+    			voices[ch].dc_block_freq_last = voices[ch].dc_block_freq;
+    			voices[ch].comp_dirty = true;
+    		}
+			voices[ch].delay_out = voices[ch].dc_block.process(voices[ch].delay_out);
+
+			// recalculate the loop delay compensation only if coefficients or pitch changed
+			if (voices[ch].comp_dirty || voices[ch].freq != voices[ch].comp_freq) {
+				// in the delay range there is no pitch to correct, only the feedback sample is compensated
+				float w = voices[ch].freq * a_angular_time;
+				voices[ch].delay_comp = 1.0;
+				if (voices[ch].freq > 20.f) voices[ch].delay_comp += getLoopDelay(voices[ch].dc_block, a_type != 5 ? &voices[ch].filter : nullptr, w);
+				voices[ch].comp_freq = voices[ch].freq;
+				voices[ch].comp_dirty = false;
+			}
 
 			// add saturation to limit the signal between -1 and +1
-			delay_out[ch] = clamp(saturate(delay_out[ch] * a_feedback),-2.f, 2.f); 
+			voices[ch].delay_out = clamp(saturate(voices[ch].delay_out * a_feedback),-2.f, 2.f); 
 
 			// write the current sample to a new variable to form a feedback loop
-			last_delay_out[ch] = delay_out[ch];
+			voices[ch].last_delay_out = voices[ch].delay_out;
 
 			
 
@@ -461,31 +1012,44 @@ struct Alae : Module {
 			if (outputs[OUT_AUDIO_LEFT].isConnected() && outputs[OUT_AUDIO_RIGHT].isConnected()) {
 				// if the channel count is odd center channel 0 to get a even stereo loudness
 				if (activeChannels % 2 == 1 and ch == 0){
-					audio_out_left = delay_out[ch] / activeChannels;
-					audio_out_right = delay_out[ch] / activeChannels;				
+					audio_out_left = voices[ch].delay_out / activeChannels;
+					audio_out_right = voices[ch].delay_out / activeChannels;				
 
 				// alternate the rest of the channels between the two outputs to form a stereo signal
 				} else {
 					if (ch % 2 == 0) {
-						audio_out_left += delay_out[ch] / (activeChannels / 2);
+						audio_out_left += voices[ch].delay_out / (activeChannels / 2);
 					} else {
-						audio_out_right += delay_out[ch] / (activeChannels / 2);	
+						audio_out_right += voices[ch].delay_out / (activeChannels / 2);	
 					} 
 			    }
 
 			// if only one output is connected make a mono signal on both channels
 			} else {
-				audio_out_left += delay_out[ch] / activeChannels;
-				audio_out_right += delay_out[ch] / activeChannels;	
+				audio_out_left += voices[ch].delay_out / activeChannels;
+				audio_out_right += voices[ch].delay_out / activeChannels;	
 			}
 
 			
 
+			// collect the taps for the shared feedback path
+			tap_feedback += voices[ch].last_delay_out * voices[ch].decay;
+
 			// last but not least increment the buffers for the next loop
-			a_write[ch] += 1;
+			voices[ch].write += 1;
 
 			// reset the write position if it hits the end of the buffer
-			if (a_write[ch]>=BufferLength) a_write[ch] -= BufferLength; 
+			if (voices[ch].write>=BufferLength) voices[ch].write -= BufferLength; 
+		}
+
+		// average the taps so the shared loop gain stays below the decay of the longest tap
+		a_tap_feedback = tap_feedback / activeChannels;
+
+		// the shared line needs the longest tap of this sample, which is only known now. the burst sounds from the next sample on
+		if (retrigger && multitap) {
+			for (int ch = 0; ch < activeChannels; ch++) {
+				retriggerVoice(ch);
+			}
 		}
 
 
@@ -514,6 +1078,15 @@ struct Alae : Module {
 		audio_out_left = crossfade(audio_in, audio_out_left, a_mix);
 		audio_out_right = crossfade(audio_in, audio_out_right, a_mix);
 
+		// swap in a newly loaded body IR, once the last replaced one has been picked up by the UI thread
+		if ((a_body_pending.load(std::memory_order_relaxed) || a_body_clear.load(std::memory_order_relaxed)) && !a_body_retired.load()) {
+			a_body_clear = false;
+			a_body_retired = a_body;
+			a_body = a_body_pending.exchange(nullptr);
+		}
+
+		// convolve the output with the body impulse response
+		if (a_body) a_body->process(audio_out_left, audio_out_right);
 
 		// rescale outputs to match -5V to + 5V
 		audio_out_left = rack::math::rescale(audio_out_left, -1.f, 1.f, -5.f, 5.f);
@@ -524,6 +1097,25 @@ struct Alae : Module {
 		outputs[OUT_AUDIO_LEFT].setVoltage(audio_out_left);
 		outputs[OUT_AUDIO_RIGHT].setVoltage(audio_out_right);
 
+		// keep the worst case process time
+		if (a_measure_time) {
+			float elapsed = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - process_start).count();
+			if (elapsed > a_peak_time.load(std::memory_order_relaxed)) a_peak_time.store(elapsed, std::memory_order_relaxed);
+		}
+
+	}
+
+
+	// LOOP FILTER
+
+	// only recalculate the filter coefficients if frequency, resonance or type changed
+	void updateLoopFilter(int ch, dsp::BiquadFilter::Type type) {
+		if (voices[ch].filter_freq == voices[ch].filter_freq_last && a_filter_res == voices[ch].filter_res_last && a_type == voices[ch].filter_type_last) return;
+		voices[ch].filter.setParameters(type, voices[ch].filter_freq, a_filter_res, 1.0f);
+		voices[ch].filter_freq_last = voices[ch].filter_freq;
+		voices[ch].filter_res_last = a_filter_res;
+		voices[ch].filter_type_last = a_type;
+		voices[ch].comp_dirty = true;
 	}
 
 
@@ -644,19 +1236,35 @@ struct Alae : Module {
 	    return a * x * x + b * x + c;
 	}
 
+	// First order Allpass (Thiran) Interpolation: one multiply-add and two reads, no high frequency damping.
+	// the fractional delay d is kept between 0.5 and 1.5 where the allpass has its most even phase response
+	float getAllpassSample(int i1, float x, float* buffer, int mask, int stride, float& state) {
+	    float d = 1.f - x;
+	    int newer = i1 + 1;
+	    if (d < 0.5f) {
+	        d += 1.f;
+	        newer += 1;
+	    }
+	    int older = (newer - 1) & mask;
+	    newer &= mask;
+
+	    float eta = (1.f - d) / (1.f + d);
+	    state = buffer[older * stride] + eta * (buffer[newer * stride] - state);
+	    return state;
+	}
+
 	// Function to get interpolated sample based on the chosen method
 	enum InterpolationType { LINEAR, LAGRANGE, CUBIC_SPLINE, QUADRATIC, NO_INTERPOLATION };
 
-	float getInterpolatedSample(float fractionalIndex, float* buffer, int bufferSize, InterpolationType type) {
-	    int i1 = (int)fractionalIndex;
-	    float x = fractionalIndex - i1; // Fractional part
-
+	// i1 is the integer read position, x the fractional part. mask is the power of two buffer size minus one, stride the
+	// distance of two samples in the buffer
+	float getInterpolatedSample(int i1, float x, float* buffer, int mask, int stride, InterpolationType type) {
 	    // Wrap indices for circular buffer
-	    int i0 = (i1 - 1 + bufferSize) % bufferSize;
-	    int i2 = (i1 + 1) % bufferSize;
-	    int i3 = (i1 + 2) % bufferSize;
+	    int i0 = (i1 - 1) & mask;
+	    int i2 = (i1 + 1) & mask;
+	    int i3 = (i1 + 2) & mask;
 
-	    float samples[4] = { buffer[i0], buffer[i1], buffer[i2], buffer[i3] };
+	    float samples[4] = { buffer[i0 * stride], buffer[i1 * stride], buffer[i2 * stride], buffer[i3 * stride] };
 
 	    switch (type) {
 	        case LINEAR:
@@ -679,6 +1287,476 @@ struct Alae : Module {
 
 
 
+	// RESONATOR STATE SNAPSHOTS
+
+	// number of samples behind the write position that are still read: delay length plus tracking offset and interpolation
+	// taps, and a loop compensation that makes the delay longer
+	int activeLength(int ch) {
+		double comp = (a_loop_comp == 1) ? std::min(voices[ch].delay_comp, 0.0) : 0.0;
+		return clamp((int)(voices[ch].index - comp) + 8, 8, BufferLength);
+	}
+
+	// the part of a voices own line that is read. in multi-tap mode voice 0 owns the shared line up to the longest tap
+	// and the lines of the other voices arent read at all
+	int lineLength(int ch) {
+		if (!a_multitap_last) return activeLength(ch);
+		if (ch != 0) return 0;
+		int length = 0;
+		for (int tap = 0; tap < activeChannels; tap++) length = std::max(length, activeLength(tap));
+		return length;
+	}
+
+	// a voice in the pool reads and writes only there, its full length buffer gets the pool copied back when it leaves
+	float sampleAt(int ch, int pos) {
+		return voices[ch].in_pool ? a_short_pool[pos & (ShortLength - 1)][ch] : buffers[ch][pos];
+	}
+
+	void writeSample(int ch, int pos, float value) {
+		if (voices[ch].in_pool) a_short_pool[pos & (ShortLength - 1)][ch] = value;
+		else buffers[ch][pos] = value;
+	}
+
+	// write the value a stale sample stands for, age counts from the write position of the current sample. after multi-tap
+	// mode that is the shared line at the same age, so the voice keeps ringing with what its tap played (only lines above 0
+	// get there, voice 0 has advanced its write position by then). after a reset it is silence or the noise burst
+	void settleSample(int ch, int pos, int age) {
+		if (age < voices[ch].fresh) return;
+		float value = 0.f;
+		if (voices[ch].stale_shared) {
+			// while voice 0 runs in the pool only its newest pool length of the shared history is left
+			int shared = (voices[0].write - 1 - age) & (BufferLength - 1);
+			if (!voices[0].in_pool) value = buffers[0][shared];
+			else if (age < ShortLength) value = a_short_pool[shared & (ShortLength - 1)][0];
+		}
+		else if (((voices[ch].burst_end - 1 - pos) & (BufferLength - 1)) < voices[ch].burst) value = burstNoise(voices[ch].burst_seed, pos);
+		writeSample(ch, pos, value);
+	}
+
+	// settle the samples all interpolators read around a read position
+	void settleAround(int line, uint64_t read_phase, int write) {
+		for (int i = -1; i <= 2; i++) {
+			int pos = ((read_phase >> 32) + i) & (BufferLength - 1);
+			settleSample(line, pos, (write - pos) & (BufferLength - 1));
+		}
+	}
+
+	// settle the newest `length` samples at once, outside of the read path (before process writes the next sample)
+	void settleLine(int ch, int length) {
+		if (voices[ch].fresh >= BufferLength) return;
+		for (int i = 1; i <= length; i++) {
+			settleSample(ch, (voices[ch].write - i) & (BufferLength - 1), i - 1);
+		}
+	}
+
+	// move the newest ShortLength samples of a voice into the short pool
+	void enterPool(int ch) {
+		int pos = voices[ch].write - ShortLength;
+		if (pos < 0) pos += BufferLength;
+		for (int i = 0; i < ShortLength; i++) {
+			a_short_pool[pos & (ShortLength - 1)][ch] = buffers[ch][pos];
+			if (++pos >= BufferLength) pos -= BufferLength;
+		}
+		voices[ch].in_pool = true;
+	}
+
+	// copy the settled pool back into the full length buffer. the rest of the buffer missed every write while the voice was in
+	// the pool, so everything older than one pool length settles to silence when it gets read
+	void leavePool(int ch) {
+		if (!voices[ch].in_pool) return;
+		settleLine(ch, ShortLength);
+		int pos = voices[ch].write - ShortLength;
+		if (pos < 0) pos += BufferLength;
+		for (int i = 0; i < ShortLength; i++) {
+			buffers[ch][pos] = a_short_pool[pos & (ShortLength - 1)][ch];
+			if (++pos >= BufferLength) pos -= BufferLength;
+		}
+		voices[ch].in_pool = false;
+		voices[ch].fresh = ShortLength;
+		voices[ch].stale_shared = false;
+		voices[ch].burst = 0;
+	}
+
+	// start a capture or a recall on the audio thread. the voice state is taken or set at once, the delay lines follow in chunks
+	void startTransfer(ResonatorSnapshot* s, bool capture) {
+		if (!s) return;
+
+		// the resampled tails of a pending sample rate change come with the new rate
+		if (!capture && s->sample_rate == a_rate_pending.load(std::memory_order_relaxed)) applyPendingRate();
+
+		a_transfer = s;
+		a_transfer_capture = capture;
+		a_transfer_done = 0;
+
+		// the chunks go straight to the full length buffers, no voice enters the pool until the transfer is done
+		for (int ch = 0; ch < uni_chans; ch++) leavePool(ch);
+
+		if (capture) {
+			s->voices = activeChannels;
+			s->sample_rate = a_sample_rate;
+		}
+
+		for (int ch = 0; ch < uni_chans; ch++) {
+			int length = 0;
+			if (ch < s->voices) {
+				if (capture) {
+					s->last_delay_out[ch] = voices[ch].last_delay_out;
+					for (int i = 0; i < 2; i++) {
+						s->filter_x[ch][i] = voices[ch].filter.x[i];
+						s->filter_y[ch][i] = voices[ch].filter.y[i];
+						s->dc_block_x[ch][i] = voices[ch].dc_block.x[i];
+						s->dc_block_y[ch][i] = voices[ch].dc_block.y[i];
+					}
+					length = std::min(lineLength(ch), (int)s->samples[ch].size());
+					s->lengths[ch] = length;
+				} else {
+					voices[ch].last_delay_out = s->last_delay_out[ch];
+					for (int i = 0; i < 2; i++) {
+						voices[ch].filter.x[i] = s->filter_x[ch][i];
+						voices[ch].filter.y[i] = s->filter_y[ch][i];
+						voices[ch].dc_block.x[i] = s->dc_block_x[ch][i];
+						voices[ch].dc_block.y[i] = s->dc_block_y[ch][i];
+					}
+					length = std::min(std::min(s->lengths[ch], (int)s->samples[ch].size()), BufferLength);
+					voices[ch].fresh = std::max(voices[ch].fresh, length + 1);
+				}
+			}
+
+			a_transfer_length[ch] = length;
+			a_transfer_start[ch] = (voices[ch].write - length) & (BufferLength - 1);
+		}
+	}
+
+	// copy the next chunk of every voice, oldest samples first. a recall stays ahead of the read position, which walks into the
+	// region one sample per sample, and a capture is done long before the write position comes around to the region
+	void continueTransfer() {
+		ResonatorSnapshot* s = a_transfer;
+		int end = a_transfer_done + TransferChunk;
+		bool finished = true;
+
+		for (int ch = 0; ch < uni_chans; ch++) {
+			int stop = std::min(end, a_transfer_length[ch]);
+			for (int i = a_transfer_done; i < stop; i++) {
+				int pos = (a_transfer_start[ch] + i) & (BufferLength - 1);
+				if (a_transfer_capture) {
+					if (voices[ch].fresh < BufferLength) settleSample(ch, pos, (voices[ch].write - 1 - pos) & (BufferLength - 1));
+					s->samples[ch][i] = buffers[ch][pos];
+				} else {
+					writeSample(ch, pos, s->samples[ch][i]);
+				}
+			}
+			if (end < a_transfer_length[ch]) finished = false;
+		}
+		a_transfer_done = end;
+		if (!finished) return;
+
+		if (a_transfer_capture) a_captured = s;
+		else a_recalled = s;
+		a_transfer = nullptr;
+	}
+
+	// write a snapshot at once so its newest sample sits right behind the current write position. only for modules that arent processing yet
+	void applySnapshot(const ResonatorSnapshot& s) {
+		for (int ch = 0; ch < s.voices; ch++) {
+			leavePool(ch);
+			voices[ch].last_delay_out = s.last_delay_out[ch];
+			for (int i = 0; i < 2; i++) {
+				voices[ch].filter.x[i] = s.filter_x[ch][i];
+				voices[ch].filter.y[i] = s.filter_y[ch][i];
+				voices[ch].dc_block.x[i] = s.dc_block_x[ch][i];
+				voices[ch].dc_block.y[i] = s.dc_block_y[ch][i];
+			}
+
+			int length = s.lengths[ch];
+			int pos = voices[ch].write - length;
+			if (pos < 0) pos += BufferLength;
+
+			for (int i = 0; i < length; i++) {
+				buffers[ch][pos] = s.samples[ch][i];
+				if (++pos >= BufferLength) pos -= BufferLength;
+			}
+		}
+	}
+
+	// UI thread, every frame: free recalls the audio thread is done with, collect finished captures and start the next one.
+	// while the state is saved with the patch a capture runs about once a second, so saving takes the latest one and never
+	// waits for the audio thread. the two capture buffers are allocated once and swapped. after a sample rate change the
+	// next capture gets resampled and recalled right away
+	void collectTransfers() {
+		if (a_recalled.load(std::memory_order_relaxed)) delete a_recalled.exchange(nullptr);
+
+		if (a_rate_request.exchange(false)) a_resample_wanted = true;
+		// body changes of a sample rate change or a loaded patch
+		if (a_body_reload.exchange(false)) {
+			if (a_body_file[0]) requestBodyLoad();
+			else clearBody();
+		}
+
+		ResonatorSnapshot* done = a_captured.exchange(nullptr);
+		if (done && a_resample_capture) {
+			// the audio thread still runs at the old rate and takes over the new one when this recall starts
+			a_capture_running = false;
+			a_resample_capture = false;
+			float rate = a_rate_pending.load();
+			if (rate > 0.f) {
+				ResonatorSnapshot* resampled = trimSnapshot(*done);
+				resampleSnapshot(*resampled, rate);
+				delete a_recall.exchange(resampled);
+			}
+			a_state_spare.reset(done);
+		} else if (done) {
+			a_capture_running = false;
+			a_state_spare = std::move(a_state_latest);
+			a_state_latest.reset(done);
+			if (a_store_slot >= 0) a_snapshot_slots[a_store_slot].reset(trimSnapshot(*done));
+			a_store_slot = -1;
+		}
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		bool wanted = a_resample_wanted || a_store_slot >= 0 || (a_store_state && now - a_capture_time > std::chrono::seconds(1));
+		if (wanted && !a_capture_running) {
+			if (!a_state_spare) {
+				a_state_spare.reset(new ResonatorSnapshot);
+				for (int ch = 0; ch < uni_chans; ch++) a_state_spare->samples[ch].resize(BufferLength);
+			}
+			a_capture_time = now;
+			a_capture_running = true;
+			a_resample_capture = a_resample_wanted;
+			a_resample_wanted = false;
+			delete a_capture.exchange(a_state_spare.release());
+		}
+
+		// without state saving the capture buffers go again
+		if (!a_store_state && a_store_slot < 0 && !a_capture_running) {
+			a_state_latest.reset();
+			a_state_spare.reset();
+		}
+	}
+
+	// store the next finished capture in slot A or B (UI thread)
+	void storeSlot(int slot) {
+		a_store_slot = slot;
+	}
+
+	// hand a copy of slot A or B to the audio thread, so the slot can be replaced while the recall is still running
+	void recallSlot(int slot) {
+		if (!a_snapshot_slots[slot]) return;
+		delete a_recall.exchange(new ResonatorSnapshot(*a_snapshot_slots[slot]));
+	}
+
+	std::string getStatePath() {
+		return system::join(getPatchStorageDirectory(), "resonator_state.bin");
+	}
+
+	// save the resonator state next to the patch
+	void onSave(const SaveEvent& e) override {
+		if (!a_body_file[0]) system::remove(getBodyPath());
+
+		if (!a_store_state) {
+			system::remove(getStatePath());
+			return;
+		}
+
+		// no capture has finished since the state saving got enabled, the file of the last save stays
+		if (!a_state_latest) return;
+		std::vector<uint8_t> data = encodeSnapshot(*a_state_latest);
+
+		createPatchStorageDirectory();
+		FILE* file = std::fopen(getStatePath().c_str(), "wb");
+		if (!file) return;
+		std::fwrite(data.data(), 1, data.size(), file);
+		std::fclose(file);
+	}
+
+	// load the resonator state when the patch is opened. the module isnt processing yet, so it can be applied directly
+	void onAdd(const AddEvent& e) override {
+		// the patch storage only exists once the module is added, so the body IR of the patch gets loaded here
+		a_added = true;
+		if (a_body_file[0]) requestBodyLoad();
+
+		if (!a_store_state) return;
+
+		FILE* file = std::fopen(getStatePath().c_str(), "rb");
+		if (!file) return;
+		std::vector<uint8_t> data;
+		uint8_t chunk[4096];
+		size_t n;
+		while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + n);
+		std::fclose(file);
+
+		ResonatorSnapshot snapshot;
+		if (!decodeSnapshot(data, snapshot)) return;
+
+		// the patch may have been saved at another sample rate
+		if (a_resample_state && snapshot.sample_rate > 0.f && snapshot.sample_rate != a_sample_rate) {
+			resampleSnapshot(snapshot, a_sample_rate);
+		}
+		applySnapshot(snapshot);
+	}
+
+
+
+	// RESET AND RETRIGGER
+
+	// silence a voice: the filter states at once, the delay line lazily - everything written before now settles to silence
+	// when it gets read (see settleSample), so a reset costs the same at every delay length
+	void resetVoice(int ch) {
+		voices[ch].fresh = 0;
+		voices[ch].stale_shared = false;
+		voices[ch].burst = 0;
+		voices[ch].burst_end = voices[ch].write;
+
+		voices[ch].filter.reset();
+		voices[ch].dc_block.reset();
+		voices[ch].last_delay_out = 0.f;
+		voices[ch].allpass_state = 0.f;
+		voices[ch].excite_count = 0;
+
+		// the shared feedback of the taps would otherwise refill the cleared line
+		if (a_multitap_last) a_tap_feedback = 0.f;
+	}
+
+	// reset a voice and excite it with exactly one period of noise (settled straight into the delay line, so it sounds without latency) or input signal
+	void retriggerVoice(int ch) {
+		resetVoice(ch);
+
+		// on the shared multi-tap line the burst has to reach the longest tap, the other voices have no line to excite
+		int period = clamp((int)voices[ch].index, 1, BufferLength);
+		if (a_multitap_last) {
+			if (ch != 0) return;
+			period = std::max(lineLength(0) - 8, 1);
+		}
+		if (a_excite_mode == 1) {
+			voices[ch].burst = period;
+			voices[ch].burst_seed = random::u32();
+		} else if (a_excite_mode == 2) {
+			voices[ch].excite_count = period;
+		}
+	}
+
+	// initialize from the module menu also silences the resonators
+	void onReset(const ResetEvent& e) override {
+		Module::onReset(e);
+		for (int ch = 0; ch < uni_chans; ch++) {
+			resetVoice(ch);
+		}
+	}
+
+
+
+	// SAMPLE RATE
+
+	void setSampleRate(float sampleRate) {
+		a_sample_rate = sampleRate;
+		a_sample_time = 1.f / sampleRate;
+		a_nyquist = sampleRate / 2.f;
+		a_angular_time = 2.f * M_PI / sampleRate;
+
+		// calculate lowest possible pitch 1VOct factor - calculation based on sample rate
+		a_lowest_pitch = std::log2((sampleRate / BufferLength) / dsp::FREQ_C4);
+
+		// normalized coefficients are stale now, force the next sample to recalculate them
+		for (int ch = 0; ch < uni_chans; ch++) {
+			voices[ch].filter_freq_last = 0.f;
+			voices[ch].dc_block_freq_last = 0.f;
+			voices[ch].comp_dirty = true;
+		}
+	}
+
+	// called by the engine under its lock whenever the sample rate changes. ringing tails are resampled from the UI thread
+	// (see collectTransfers), where the capture also covers every tap of the shared multi-tap line, and the new constants
+	// wait for their recall. a module that hasnt processed yet has no tails and takes them at once
+	void onSampleRateChange(const SampleRateChangeEvent& e) override {
+		if (a_resample_state && a_processing && e.sampleRate != a_sample_rate) {
+			a_rate_pending = e.sampleRate;
+			a_rate_wait = 0;
+			a_rate_request = true;
+		} else {
+			a_rate_pending = 0.f;
+			setSampleRate(e.sampleRate);
+		}
+		if (a_body_file[0]) a_body_reload = true;
+	}
+
+	// audio thread
+	void applyPendingRate() {
+		setSampleRate(a_rate_pending.exchange(0.f));
+		a_rate_wait = 0;
+	}
+
+
+
+	// BODY RESONATOR
+
+	std::string getBodyPath() {
+		return system::join(getPatchStorageDirectory(), "body.wav");
+	}
+
+	// copy a WAV into the patch storage, so the patch still finds it on other machines, and load it (UI thread)
+	void setBody(const std::string& path) {
+		createPatchStorageDirectory();
+		if (!system::copy(path, getBodyPath())) return;
+		std::snprintf(a_body_file, sizeof(a_body_file), "%s", system::getFilename(path).c_str());
+		requestBodyLoad();
+	}
+
+	// load the IR of the patch storage on the loader thread. only waits if the previous load is still running
+	void requestBodyLoad() {
+		if (a_body_thread.joinable()) a_body_thread.join();
+		float rate = a_rate_pending.load();
+		a_body_thread = std::thread(&Alae::loadBody, this, getBodyPath(), rate > 0.f ? rate : a_sample_rate);
+	}
+
+	// load, resample, normalize and partition an impulse response off the audio thread, then hand it to process()
+	void loadBody(std::string path, float sample_rate) {
+		std::vector<float> ir[2];
+		int channels = 0;
+		float rate = 0.f;
+		if (!loadWav(path, ir, channels, rate)) return;
+
+		double energy = 0.0;
+		for (int c = 0; c < channels; c++) {
+			if (rate != sample_rate) {
+				std::vector<float> resampled((size_t)std::ceil(ir[c].size() * (double)sample_rate / rate) + 1);
+				SRC_DATA data = {};
+				data.data_in = ir[c].data();
+				data.input_frames = ir[c].size();
+				data.data_out = resampled.data();
+				data.output_frames = resampled.size();
+				data.src_ratio = (double)sample_rate / rate;
+				data.end_of_input = 1;
+				if (src_simple(&data, SRC_SINC_MEDIUM_QUALITY, 1) != 0) return;
+				resampled.resize(data.output_frames_gen);
+				ir[c].swap(resampled);
+			}
+			ir[c].resize(std::min(ir[c].size(), (size_t)(BodyMaxSeconds * sample_rate)));
+			for (float v : ir[c]) energy += v * v;
+		}
+		if (ir[0].empty() || energy <= 0.0) return;
+		if (channels == 2) ir[1].resize(ir[0].size());
+
+		// normalize to unit energy per channel so the body doesnt change the overall level much
+		float gain = 1.f / std::sqrt(energy / channels);
+		for (int c = 0; c < channels; c++) {
+			for (float& v : ir[c]) v *= gain;
+		}
+
+		BodyConvolver* body = new BodyConvolver;
+		body->setImpulseResponse(ir, channels);
+
+		delete a_body_retired.exchange(nullptr);
+		delete a_body_pending.exchange(body);
+	}
+
+	void clearBody() {
+		if (a_body_thread.joinable()) a_body_thread.join();
+		delete a_body_retired.exchange(nullptr);
+		delete a_body_pending.exchange(nullptr);
+		a_body_clear = true;
+		a_body_file[0] = 0;
+	}
+
+
+
    // Override `dataToJson` to save values without a param to JSON
     json_t *dataToJson() override {
         // Create a JSON object
@@ -689,6 +1767,12 @@ struct Alae : Module {
         json_object_set_new(rootJ, "InterpolationSelect", json_integer(InterpolationSelect));
         json_object_set_new(rootJ, "a_tune_sprd_mode", json_integer(a_tune_sprd_mode));
         json_object_set_new(rootJ, "a_fltr_sprd_mode", json_integer(a_fltr_sprd_mode));
+        json_object_set_new(rootJ, "a_store_state", json_integer(a_store_state));
+        json_object_set_new(rootJ, "a_loop_comp", json_integer(a_loop_comp));
+        json_object_set_new(rootJ, "a_resample_state", json_integer(a_resample_state));
+        json_object_set_new(rootJ, "a_excite_mode", json_integer(a_excite_mode));
+        json_object_set_new(rootJ, "a_delay_mode", json_integer(a_delay_mode));
+        json_object_set_new(rootJ, "a_body_file", json_string(a_body_file));
 
         return rootJ;
     }
@@ -712,97 +1796,44 @@ struct Alae : Module {
 
         json_t *intJ6 = json_object_get(rootJ, "a_fltr_sprd_mode");
         if (intJ6) a_fltr_sprd_mode = json_integer_value(intJ6);
-    }
-};
 
+        json_t *intJ7 = json_object_get(rootJ, "a_store_state");
+        if (intJ7) a_store_state = json_integer_value(intJ7);
 
-// module widget constructor
-struct AlaeWidget : ModuleWidget {
-	AlaeWidget(Alae* module) {
-		setModule(module);
-		// load panel svg
-		setPanel(createPanel(asset::plugin(pluginInstance, "res/alae_v2_rev3.svg")));
-
-		// place screws
-		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
-		addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
-		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-		addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-
-		// place components
-		addParam(createParamCentered<BigLuggezKnob>(mm2px(Vec(36.852, 20.109)), module, Alae::PRM_TUNE));
-		addParam(createParamCentered<BigLuggezKnob>(mm2px(Vec(64.852, 20.109)), module, Alae::PRM_FLTR_FREQ));
-
-		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(36.852, 58.814)), module, Alae::PRM_TUNE_SPRD));
-		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(50.852, 48.069)), module, Alae::PRM_VOX_COUNT));
-		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(64.852, 58.814)), module, Alae::PRM_FLTR_SPRD));
-		addParam(createParamCentered<SmallLuggezKnob> (mm2px(Vec(64.852, 39.924)), module, Alae::PRM_FLTR_RES));
-		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(16.852, 77.028)), module, Alae::PRM_DEC));
-		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(84.852, 77.620)), module, Alae::PRM_FB));
-		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(64.852, 87.220)), module, Alae::PRM_VCA));
-		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(36.852, 87.220)), module, Alae::PRM_DRYWET));
-
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(21.852,  12.942)), module, Alae::ATT_TUNE_TRCK));
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(21.852,  36.424)), module, Alae::ATT_TUNE_FM));
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(21.852,  58.424)), module, Alae::ATT_TUNE_SPRD)); 
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(79.852,  12.924)), module, Alae::ATT_FLTR_FREQ));
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(79.852,  58.424)), module, Alae::ATT_FLTR_SPRD));
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(79.852,  36.424)), module, Alae::ATT_FLTR_RES));
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(16.852,  90.636)), module, Alae::ATT_DEC));
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(84.852,  91.228)), module, Alae::ATT_FB));
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(50.852,  95.825)), module, Alae::ATT_DRYWET));
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(50.852, 115.078)), module, Alae::ATT_FB_IN));
-		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(36.852,  39.924)), module, Alae::PRM_FINE_TUNE));
-
-
-		// place jacks
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec( 8.738,  13.217)), module, Alae::IN_TUNE_1VOCT));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec( 8.738,  36.717)), module, Alae::IN_TUNE_FM));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec( 8.738,  58.217)), module, Alae::IN_TUNE_SPRD));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(92.738,  13.217)), module, Alae::IN_FLTR_FREQ));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(92.738,  36.717)), module, Alae::IN_FLTR_RES));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(92.738,  58.127)), module, Alae::IN_FLTR_SPRD));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(16.738, 104.670)), module, Alae::IN_DEC));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(84.738, 104.670)), module, Alae::IN_FB));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(10.926, 116.117)), module, Alae::IN_AUDIO));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(64.738, 104.670)), module, Alae::IN_VCA));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(36.738, 104.670)), module, Alae::IN_DRYWET));
-		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(22.550, 116.117)), module, Alae::IN_AUDIO_FB));
-	
-		addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(78.926, 116.117)), module, Alae::OUT_AUDIO_LEFT));
-		addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(90.550, 116.117)), module, Alae::OUT_AUDIO_RIGHT));
+        json_t *intJ8 = json_object_get(rootJ, "a_loop_comp");
+        if (intJ8) a_loop_comp = json_integer_value(intJ8);
 
+        json_t *intJ9 = json_object_get(rootJ, "a_resample_state");
+        if (intJ9) a_resample_state = json_integer_value(intJ9);
 
+        json_t *intJ10 = json_object_get(rootJ, "a_excite_mode");
+        if (intJ10) a_excite_mode = json_integer_value(intJ10);
 
-		// place buttons
-		addParam(createLightParamCentered<VCVLightButton<MediumSimpleLight<YellowLight>>>(mm2px(Vec(50.852, 68.999)), module, Alae::BTN_TYPE, Alae::LGHT_TYPE));
-		addParam(createLightParamCentered<VCVLightButton<MediumSimpleLight<YellowLight>>>(mm2px(Vec(50.852, 19.986)), module, Alae::BTN_KEYTRACK, Alae::LGHT_KEYTRACK));
-		
-		// place lights
-		addChild(createLightCentered<SmallLight<YellowLight>>(mm2px(Vec(44.316, 74.655)), module, Alae::LGHT_LP));
-		addChild(createLightCentered<SmallLight<YellowLight>>(mm2px(Vec(48.673, 74.655)), module, Alae::LGHT_BP));
-		addChild(createLightCentered<SmallLight<YellowLight>>(mm2px(Vec(53.031, 74.655)), module, Alae::LGHT_HP));
-		addChild(createLightCentered<SmallLight<YellowLight>>(mm2px(Vec(57.389, 74.655)), module, Alae::LGHT_NO));
-	}
+        json_t *intJ11 = json_object_get(rootJ, "a_delay_mode");
+        if (intJ11) a_delay_mode = json_integer_value(intJ11);
 
+        // a patch or preset without a body clears the current one. the engine holds its lock here, so a module that is already
+        // running loads or clears it on the UI thread (see collectTransfers), otherwise onAdd loads it
+        json_t *strJ1 = json_object_get(rootJ, "a_body_file");
+        const char* body_file = json_string_value(strJ1);
+        std::snprintf(a_body_file, sizeof(a_body_file), "%s", body_file ? body_file : "");
+        if (a_added) a_body_reload = true;
+    }
+};
 
-	// create custom menu items for the right click menu
-	MenuItem* createMenuItem(const std::string& label, const std::string& rightText, std::function<void()> action) {
-	    struct ActionMenuItem : MenuItem {
-	        std::function<void()> action;
-	        void onAction(const event::Action& e) override {
-	            if (action)
-	                action();
-	        }
-	    };
 
-	    ActionMenuItem* item = new ActionMenuItem();
-	    item->text = label;
-	    item->rightText = rightText;
-	    item->action = action;
-	    return item;
+// module widget constructor
+struct AlaeWidget : AlaePanelWidget {
+	// free finished snapshot recalls on the UI thread
+	void step() override {
+		Alae* alae = dynamic_cast<Alae*>(this->module);
+		if (alae) alae->collectTransfers();
+		ModuleWidget::step();
 	}
 
+	AlaeWidget(Alae* module) : AlaePanelWidget(module) {}
+
+
 	// create the right click menus
 	void appendContextMenu(Menu* menu) override {
 	    ModuleWidget::appendContextMenu(menu);
@@ -814,20 +1845,7 @@ struct AlaeWidget : ModuleWidget {
 	    // Add a separator
 	    menu->addChild(new MenuSeparator);
 
-    	menu->addChild(createSubmenuItem("Saturation Type", "", [module, this](Menu* submenu) {
-		    // Add menu items with checkmarks
-		    submenu->addChild(this->createMenuItem("tanh", module->a_sat_select == 1 ? "✔" : "", 				[module]() { module->a_sat_select = 1; }));
-		    submenu->addChild(this->createMenuItem("soft clipping", module->a_sat_select == 2 ? "✔" : "", 		[module]() { module->a_sat_select = 2; }));
-		    submenu->addChild(this->createMenuItem("hard clipping", module->a_sat_select == 3 ? "✔" : "", 		[module]() { module->a_sat_select = 3; }));
-		    submenu->addChild(this->createMenuItem("exponential", module->a_sat_select == 4 ? "✔" : "", 		[module]() { module->a_sat_select = 4; }));
-		    submenu->addChild(this->createMenuItem("sigmoid", module->a_sat_select == 5 ? "✔" : "", 			[module]() { module->a_sat_select = 5; }));
-		    submenu->addChild(this->createMenuItem("atan", module->a_sat_select == 6 ? "✔" : "", 				[module]() { module->a_sat_select = 6; }));
-		    submenu->addChild(this->createMenuItem("cubic", module->a_sat_select == 7 ? "✔" : "", 				[module]() { module->a_sat_select = 7; }));
-		    submenu->addChild(this->createMenuItem("asymetric", module->a_sat_select == 8 ? "✔" : "", 			[module]() { module->a_sat_select = 8; }));
-		    submenu->addChild(this->createMenuItem("soft exponential", module->a_sat_select == 9 ? "✔" : "",	[module]() { module->a_sat_select = 9; }));
-		    submenu->addChild(this->createMenuItem("waveshaper", module->a_sat_select == 10 ? "✔" : "", 		[module]() { module->a_sat_select = 10; }));
-		    submenu->addChild(this->createMenuItem("sine", module->a_sat_select == 11 ? "✔" : "",		 		[module]() { module->a_sat_select = 11; }));
-		}));
+    	appendSaturationMenu(menu, module);
 
 		// Add a separator
 	    menu->addChild(new MenuSeparator);
@@ -839,23 +1857,65 @@ struct AlaeWidget : ModuleWidget {
 		    submenu->addChild(this->createMenuItem("Cubic Spline", 		module->InterpolationSelect == 3 ? "✔" : "", 			[module]() { module->InterpolationSelect = 3; }));
 		    submenu->addChild(this->createMenuItem("Quadratic", 		module->InterpolationSelect == 4 ? "✔" : "", 			[module]() { module->InterpolationSelect = 4; }));
 		    submenu->addChild(this->createMenuItem("No Interpolation", 	module->InterpolationSelect == 5 ? "✔" : "", 			[module]() { module->InterpolationSelect = 5; }));
+		    submenu->addChild(this->createMenuItem("Allpass (Thiran)", 	module->InterpolationSelect == 6 ? "✔" : "", 			[module]() { module->InterpolationSelect = 6; }));
+		    submenu->addChild(new MenuSeparator);
+		    submenu->addChild(this->createMenuItem("Filter Delay Compensation", module->a_loop_comp == 1 ? "✔" : "", 		[module]() { module->a_loop_comp ^= 1; }));
 		}));
 
     	// Add a separator
 	    menu->addChild(new MenuSeparator);
 
-    	menu->addChild(createSubmenuItem("Spread type - Tuning", "", [module, this](Menu* submenu) {
+    	appendSpreadMenus(menu, module);
+
+		menu->addChild(new MenuSeparator);
+
+    	menu->addChild(createSubmenuItem("Delay Mode", "", [module, this](Menu* submenu) {
 		    // Add menu items with checkmarks
-		    submenu->addChild(this->createMenuItem("Even", 		module->a_tune_sprd_mode == 0 ? "✔" : "", 	[module]() { module->a_tune_sprd_mode = 0; }));
-		    submenu->addChild(this->createMenuItem("Random", 	module->a_tune_sprd_mode == 1 ? "✔" : "", 	[module]() { module->a_tune_sprd_mode = 1; }));
+		    submenu->addChild(this->createMenuItem("Separate lines", 			module->a_delay_mode == 0 ? "✔" : "", 	[module]() { module->a_delay_mode = 0; }));
+		    submenu->addChild(this->createMenuItem("Multi-tap", 				module->a_delay_mode == 1 ? "✔" : "", 	[module]() { module->a_delay_mode = 1; }));
+		    submenu->addChild(this->createMenuItem("Auto (multi-tap in delay range)", module->a_delay_mode == 2 ? "✔" : "", [module]() { module->a_delay_mode = 2; }));
 		}));
 
 		menu->addChild(new MenuSeparator);
 
-    	menu->addChild(createSubmenuItem("Spread type - Filter", "", [module, this](Menu* submenu) {
+    	menu->addChild(createSubmenuItem("Retrigger Excitation", "", [module, this](Menu* submenu) {
 		    // Add menu items with checkmarks
-		    submenu->addChild(this->createMenuItem("Even", 		module->a_fltr_sprd_mode == 0 ? "✔" : "", 	[module]() { module->a_fltr_sprd_mode = 0; }));
-		    submenu->addChild(this->createMenuItem("Random", 	module->a_fltr_sprd_mode == 1 ? "✔" : "", 	[module]() { module->a_fltr_sprd_mode = 1; }));
+		    submenu->addChild(this->createMenuItem("Off (choke only)", 	module->a_excite_mode == 0 ? "✔" : "", 	[module]() { module->a_excite_mode = 0; }));
+		    submenu->addChild(this->createMenuItem("Noise", 			module->a_excite_mode == 1 ? "✔" : "", 	[module]() { module->a_excite_mode = 1; }));
+		    submenu->addChild(this->createMenuItem("Input", 			module->a_excite_mode == 2 ? "✔" : "", 	[module]() { module->a_excite_mode = 2; }));
+		}));
+
+		menu->addChild(new MenuSeparator);
+
+    	menu->addChild(createSubmenuItem("Body Resonator", module->a_body_file, [module, this](Menu* submenu) {
+		    submenu->addChild(this->createMenuItem("Load impulse response...", "", [module]() {
+		    	osdialog_filters* filters = osdialog_filters_parse("WAV:wav");
+		    	char* pathC = osdialog_file(OSDIALOG_OPEN, NULL, NULL, filters);
+		    	osdialog_filters_free(filters);
+		    	if (!pathC) return;
+		    	module->setBody(pathC);
+		    	std::free(pathC);
+		    }));
+		    submenu->addChild(this->createMenuItem("Clear", "", [module]() { module->clearBody(); }));
+		}));
+
+		menu->addChild(new MenuSeparator);
+
+    	menu->addChild(this->createMenuItem("Measure worst process time", module->a_measure_time == 1 ? string::f("%.1f µs", module->a_peak_time.load()) : "", [module]() {
+    		module->a_measure_time ^= 1;
+    		module->a_peak_time = 0.f;
+    	}));
+
+		menu->addChild(new MenuSeparator);
+
+    	menu->addChild(createSubmenuItem("Resonator State", "", [module, this](Menu* submenu) {
+		    submenu->addChild(this->createMenuItem("Save with patch", 	module->a_store_state == 1 ? "✔" : "", 				[module]() { module->a_store_state ^= 1; }));
+		    submenu->addChild(this->createMenuItem("Resample on rate change", module->a_resample_state == 1 ? "✔" : "", 		[module]() { module->a_resample_state ^= 1; }));
+		    submenu->addChild(new MenuSeparator);
+		    submenu->addChild(this->createMenuItem("Store A", 			"", 												[module]() { module->storeSlot(0); }));
+		    submenu->addChild(this->createMenuItem("Store B", 			"", 												[module]() { module->storeSlot(1); }));
+		    submenu->addChild(this->createMenuItem("Recall A", 			module->a_snapshot_slots[0] ? "" : "empty", 		[module]() { module->recallSlot(0); }));
+		    submenu->addChild(this->createMenuItem("Recall B", 			module->a_snapshot_slots[1] ? "" : "empty", 		[module]() { module->recallSlot(1); }));
 		}));
 	}
 };
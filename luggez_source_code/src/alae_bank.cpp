@@ -0,0 +1,630 @@
+// ALAE BANK VCV RACK PLUGIN - CODE BY LUKAS ÖSTREICH 2025
+
+// up to 16 independent single voice alae resonators in one module. every resonator listens to its own channel of the
+// polyphonic inputs, the audio path runs four resonators side by side in simd lanes and all delay lines share one arena.
+// the lines are a quarter of alaes (BankLength against BufferLength), so with the same tuning knob mapping the longest
+// delay is about 2,7 seconds at 48khz instead of about 10,9 and the pitch floor lies two octaves higher
+
+
+// Include nescessary files
+#include "plugin.hpp"
+#include <atomic>
+#include <chrono>
+#include <complex>
+
+using simd::float_4;
+
+#define BankMax (16) // one resonator per polyphonic channel
+#define BankGroups (BankMax / 4) // lane groups of four resonators
+#define BankLength (1<<17) // delay length per resonator - around 2,7 seconds at 48khz, the whole arena is 8 MB
+
+
+
+
+// Bank Biquad: rack's biquad with separate coefficients in every lane
+
+
+// same direct form as dsp::BiquadFilter, the coefficients get designed per resonator by a scalar filter and copied in
+struct BankBiquad {
+	float_4 b[3], a[2], x[2], y[2];
+
+	BankBiquad() {
+		b[0] = 1.f; b[1] = 0.f; b[2] = 0.f;
+		a[0] = 0.f; a[1] = 0.f;
+		reset();
+	}
+
+	void reset() {
+		x[0] = x[1] = y[0] = y[1] = 0.f;
+	}
+
+	void resetLane(int lane) {
+		x[0][lane] = x[1][lane] = y[0][lane] = y[1][lane] = 0.f;
+	}
+
+	void setLane(int lane, const dsp::BiquadFilter& design) {
+		for (int i = 0; i < 3; i++) b[i][lane] = design.b[i];
+		for (int i = 0; i < 2; i++) a[i][lane] = design.a[i];
+	}
+
+	float_4 process(float_4 in) {
+		float_4 out = b[0] * in + b[1] * x[0] + b[2] * x[1] - a[0] * y[0] - a[1] * y[1];
+		x[1] = x[0];
+		x[0] = in;
+		y[1] = y[0];
+		y[0] = out;
+		return out;
+	}
+};
+
+
+
+
+// Module Struct: Params, Inputs, Outputs & Lights - same panel and ids as alae
+
+
+struct AlaeBank : Module, AlaeIds {
+
+	// init triggers inside module to ensure they arent shared accross multiple instances
+
+    dsp::BooleanTrigger a_type_trigger;
+    dsp::BooleanTrigger a_keytrack_trigger;
+    dsp::SchmittTrigger a_gate_triggers[BankMax];
+
+    // module contructor
+
+	AlaeBank() {
+
+		// config Params Inputs and Outputs - every cv input is polyphonic, channel n modulates resonator n
+
+		config(PARAMS_LEN, INPUTS_LEN, OUTPUTS_LEN, LIGHTS_LEN);
+		configParam(PRM_VOX_COUNT, 1, BankMax, 4, "Resonator Count (without polyphonic 1VOCT)");
+
+		configParam(PRM_TUNE, -1.f, 1.f, 0.4f, "Tuning");
+		configParam(PRM_FINE_TUNE, -1.f, 1.f, 0.f, "Fine Tuning");
+		configParam(PRM_DEC, -1.f, 1.f, 0.3f, "Decay");
+		configParam(PRM_TUNE_SPRD, -1.f, 1.f, 0.f, "Tuning Spread");
+		configParam(PRM_FB, 0.f, 1.f, 0.f, "Feedback");
+		configParam(PRM_VCA, 0.f, 5.f, 2.5f, "VCA");
+		configParam(PRM_DRYWET, 0.f, 1.f, 1.f, "DRY / WET");
+
+		configParam(PRM_FLTR_FREQ, -0.1f, 1.f, 0.2f, "Filter Freq");
+		configParam(PRM_FLTR_SPRD, -1.f, 1.f, 0.f, "Filter Spread");
+		configParam(PRM_FLTR_RES, 0.f, 1.f, 0.707f, "Filter Resonance");
+
+		configParam(ATT_TUNE_TRCK, -10.f, 5.f, -0.f, "Tracking Adjustment");
+		configParam(ATT_TUNE_FM, -1.f, 1.f, 0.f, "FM");
+		configParam(ATT_TUNE_SPRD, -1.f, 1.f, 0.f, "Spread");
+		configParam(ATT_FLTR_FREQ, -1.f, 1.f, 0.f, "Filter FM");
+		configParam(ATT_FLTR_SPRD, -1.f, 1.f, 0.f, "Filter Spread");
+		configParam(ATT_FLTR_RES, -1.f, 1.f, 0.f, "Filter Resonance");
+		configParam(ATT_DEC, -1.f, 1.f, 0.f, "Decay");
+		configParam(ATT_FB, -1.f, 1.f, 0.f, "Feedback Saturation");
+		configParam(ATT_DRYWET, -1.f, 1.f, 0.f, "Dry / Wet");
+		configParam(ATT_FB_IN, -1.f, 1.f, 0.f, "External Feedback");
+
+
+		configButton(BTN_TYPE, "Filter Type");
+		configButton(BTN_KEYTRACK, "Filter Keytracking");
+
+		configInput(IN_TUNE_1VOCT, "1VOCT (channel count sets the resonator count)");
+		configInput(IN_TUNE_FM, "FM");
+		configInput(IN_TUNE_SPRD, "Spread");
+		configInput(IN_FLTR_FREQ, "Filter FM");
+		configInput(IN_FLTR_SPRD, "Filter Spread");
+		configInput(IN_FLTR_RES, "Filter Resonance");
+		configInput(IN_DEC, "Decay");
+		configInput(IN_FB, "Feedback Saturation");
+		configInput(IN_VCA, "VCA");
+		configInput(IN_DRYWET, "DRY / WET");
+		configInput(IN_AUDIO_FB, "External Feedback Input");
+		configInput(IN_GATE, "Gate / Retrigger");
+
+		configInput(IN_AUDIO, "");
+
+		configOutput(OUT_AUDIO_LEFT, "");
+		configOutput(OUT_AUDIO_RIGHT, "");
+
+		// simd vectors have no default value, the feedback samples have to start at zero
+		for (int g = 0; g < BankGroups; g++) {
+			a_last_out[g] = 0.f;
+		}
+		for (int ch = 0; ch < BankMax; ch++) {
+			a_fresh[ch] = BankLength;
+		}
+
+		// precalculate the sample rate dependent constants, the engine sends an event whenever the rate changes
+		setSampleRate(APP->engine->getSampleRate());
+	}
+
+	// init variables
+
+	// audio state of the lane groups
+	BankBiquad a_filter[BankGroups];
+	BankBiquad a_dc_block[BankGroups];
+	float_4 a_last_out[BankGroups];
+
+	// stereo gains and spread offsets of every resonator, only recalculated when the layout changes
+	float_4 a_gain_left[BankGroups], a_gain_right[BankGroups], a_active[BankGroups];
+	float_4 a_tune_offset[BankGroups], a_filter_offset[BankGroups];
+	int a_count = 0, a_layout_last = -1;
+
+	// scalar coefficient design and caches per resonator, so the filters and the delay compensation only get recalculated on changes
+	dsp::BiquadFilter a_filter_design[BankMax];
+	dsp::BiquadFilter a_dc_block_design[BankMax];
+	double a_index[BankMax] = {}, a_delay_comp[BankMax] = {}; // double up to the read phase like in alae
+	float a_filter_freq_last[BankMax] = {}, a_filter_res_last[BankMax] = {}, a_dc_block_freq_last[BankMax] = {}, a_comp_freq[BankMax] = {};
+	int a_filter_type_last[BankMax] = {};
+	bool a_comp_dirty[BankMax] = {};
+
+	float a_filter_freq_min = 30.f;
+	float a_filter_freq_max = 20000.f;
+
+	// sample rate dependent constants, only updated in onSampleRateChange
+	float a_sample_rate = 44100.f, a_sample_time = 1.f / 44100.f, a_nyquist = 22050.f, a_angular_time = 2.f * M_PI / 44100.f;
+	float a_lowest_pitch = 0.f;
+
+	// spread factors for the random spread mode, the first eight are the ones of alae
+	float a_inharm_factor[BankMax] = {0.8375f, 0.1923f, 0.5234f, 0.6152f, 0.4032f, 0.9948f, 0.2345f, 0.7812f,
+									  0.3561f, 0.9127f, 0.1489f, 0.6873f, 0.4710f, 0.8236f, 0.2954f, 0.5618f};
+
+	int a_type = 1;
+	int a_keytrack = 1;
+	int a_sat_select = 1;
+	int a_tune_sprd_mode = 1;
+	int a_fltr_sprd_mode = 1;
+	int a_loop_comp = 1;
+
+	// one output channel per resonator instead of the stereo mix
+	int a_poly_out = 0;
+
+	// optional worst case process time in microseconds, to compare the bank against the same count of alae modules
+	int a_measure_time = 0;
+	std::atomic<float> a_peak_time {0.f};
+
+	// delay line arena: one row per sample position with a column for every resonator. all resonators share the write
+	// position, so writing is one row store per sample and the rows of the recent past stay in cache together
+	int a_write = 0;
+	alignas(16) float a_arena[BankLength][BankMax] = {};
+
+	// samples written since the last reset of every resonator. older ones read as silence, or as the noise burst of a_burst
+	// samples before a_burst_end, so a reset never has to touch the strided columns of the arena
+	int a_fresh[BankMax];
+	int a_burst[BankMax] = {}, a_burst_end[BankMax] = {};
+	uint32_t a_burst_seed[BankMax] = {};
+
+	// proces function
+	// the audio thread path: no allocations, locks or system calls in here or in the functions it calls
+	void process(const ProcessArgs& args) override {
+
+		std::chrono::steady_clock::time_point process_start;
+		if (a_measure_time) process_start = std::chrono::steady_clock::now();
+
+		// a polyphonic 1VOCT input sets the resonator count, otherwise the VOX knob does
+		int count = inputs[IN_TUNE_1VOCT].isConnected() ? inputs[IN_TUNE_1VOCT].getChannels() : int(params[PRM_VOX_COUNT].getValue());
+		count = clamp(count, 1, BankMax);
+		int groups = (count + 3) / 4;
+
+		// resonators that just got added start from silence
+		for (int ch = a_count; ch < count; ch++) resetResonator(ch);
+		a_count = count;
+
+		bool stereo = outputs[OUT_AUDIO_LEFT].isConnected() && outputs[OUT_AUDIO_RIGHT].isConnected();
+		updateLayout(count, stereo);
+
+		// choke and retrigger single resonators on rising gates - a monophonic gate hits all of them. the retrigger itself waits
+		// until the resonator knows the pitch of this sample
+		bool retrigger[BankMax] = {};
+		for (int ch = 0; ch < count; ch++) {
+			retrigger[ch] = a_gate_triggers[ch].process(inputs[IN_GATE].getPolyVoltage(ch));
+		}
+
+		// filter switch logic
+		if (a_type_trigger.process(params[BTN_TYPE].getValue())) a_type++;
+		if (a_type > 5) a_type = 1;
+
+		// keytracking switch logic
+		if (a_keytrack_trigger.process(params[BTN_KEYTRACK].getValue())) a_keytrack++;
+		if (a_keytrack > 1) a_keytrack = 0;
+
+		lights[LGHT_LP].setBrightness(a_type == 1 ? 1.f : 0.f);
+		lights[LGHT_BP].setBrightness(a_type == 2 ? 1.f : 0.f);
+		lights[LGHT_HP].setBrightness(a_type == 3 ? 1.f : 0.f);
+		lights[LGHT_NO].setBrightness(a_type == 4 ? 1.f : 0.f);
+		lights[LGHT_KEYTRACK].setBrightness(a_keytrack == 1 ? 1.f : 0.f);
+
+		dsp::BiquadFilter::Type filter_type = dsp::BiquadFilter::LOWPASS;
+		if (a_type == 2) filter_type = dsp::BiquadFilter::BANDPASS;
+		if (a_type == 3) filter_type = dsp::BiquadFilter::HIGHPASS;
+		if (a_type == 4) filter_type = dsp::BiquadFilter::NOTCH;
+
+		// split tuning knob in audio and delay range, same as alae
+		float base_tune = params[PRM_TUNE].getValue() + (params[PRM_FINE_TUNE].getValue() * 0.01);
+		if (base_tune >= 0.f) {
+			base_tune = rack::math::rescale(base_tune, 0.f, 1.f, -3.3f, 4.5f);
+		} else {
+			base_tune = rack::math::rescale(base_tune, -1.f, 0.f, a_lowest_pitch, -3.3f);
+		}
+
+		// knobs are read once, the cv inputs per lane group
+		float tune_fm = params[ATT_TUNE_FM].getValue();
+		float tune_sprd = params[PRM_TUNE_SPRD].getValue(), tune_sprd_att = params[ATT_TUNE_SPRD].getValue();
+		float tracking = params[ATT_TUNE_TRCK].getValue();
+		float decay_knob = params[PRM_DEC].getValue(), decay_att = params[ATT_DEC].getValue();
+		float fb_knob = params[PRM_FB].getValue(), fb_att = params[ATT_FB].getValue();
+		float fb_in_att = params[ATT_FB_IN].getValue();
+		float filter_knob = params[PRM_FLTR_FREQ].getValue(), filter_att = params[ATT_FLTR_FREQ].getValue();
+		float fltr_sprd = params[PRM_FLTR_SPRD].getValue(), fltr_sprd_att = params[ATT_FLTR_SPRD].getValue();
+		float res_knob = params[PRM_FLTR_RES].getValue(), res_att = params[ATT_FLTR_RES].getValue();
+		float vca_knob = params[PRM_VCA].getValue();
+		float mix_knob = params[PRM_DRYWET].getValue(), mix_att = params[ATT_DRYWET].getValue();
+		bool audio_connected = inputs[IN_AUDIO].isConnected();
+		bool vca_connected = inputs[IN_VCA].isConnected();
+
+		float log_min = std::log2(a_filter_freq_min);
+		float log_range = std::log2(a_filter_freq_max) - log_min;
+
+		float_4 out_left = 0.f, out_right = 0.f;
+		float_4 outs[BankGroups];
+
+		for (int g = 0; g < groups; g++) {
+			int c = g * 4;
+
+			// read audio input and add attenuated external feedback, rescaled to -1 - +1
+			float_4 audio_in = (inputs[IN_AUDIO].getPolyVoltageSimd<float_4>(c) + inputs[IN_AUDIO_FB].getPolyVoltageSimd<float_4>(c) * fb_in_att) / 5.f;
+
+			// feedback saturation, scaled exponential for better control over small values
+			float_4 feedback = fb_knob + inputs[IN_FB].getPolyVoltageSimd<float_4>(c) / 5.f * fb_att;
+			feedback = simd::clamp(1.f + 9.f * feedback * feedback * feedback, 1.f, 10.f);
+
+			// apply noise for self oscillation if input is not connected
+			if (!audio_connected) {
+				audio_in += (feedback - 1.f) * float_4(random::uniform(), random::uniform(), random::uniform(), random::uniform()) * 0.0001f;
+			}
+
+			// unused lanes of the last group stay silent
+			audio_in *= a_active[g];
+
+			// tuning per resonator: base tuning plus its 1VOCT channel, the spread spreads the resonators against each other
+			float_4 tune_base = base_tune + inputs[IN_TUNE_1VOCT].getPolyVoltageSimd<float_4>(c);
+			float_4 spread = tune_sprd + inputs[IN_TUNE_SPRD].getPolyVoltageSimd<float_4>(c) / 5.f * tune_sprd_att;
+			spread = spread * simd::fabs(spread);
+			float_4 tune = tune_base + spread * a_tune_offset[g] + inputs[IN_TUNE_FM].getPolyVoltageSimd<float_4>(c) * tune_fm;
+			tune = simd::clamp(tune, a_lowest_pitch, 8.f);
+			float_4 freq = dsp::FREQ_C4 * simd::pow(2.f, tune);
+			float_4 index = a_sample_rate / freq;
+
+			// the delay itself comes from the pitch in double, the float index is only precise enough for the decay. reset region
+			// and noise burst are exactly one period of the new note, before the feedback sample gets written
+			for (int lane = 0; lane < 4; lane++) {
+				a_index[c + lane] = a_sample_rate / (dsp::FREQ_C4 * std::pow(2.0, (double)tune[lane]));
+				if (retrigger[c + lane]) retriggerResonator(c + lane);
+			}
+
+			// decay with polarity, scaled exponentially and turned into a feedback factor based on the pitch
+			float_4 decay = decay_knob + inputs[IN_DEC].getPolyVoltageSimd<float_4>(c) / 5.f * decay_att;
+			float_4 phase = simd::sgn(decay);
+			decay = decay * decay;
+			float_4 t60 = a_sample_rate * 60.f * decay * decay / index;
+			decay = simd::clamp(simd::exp(-3.f * std::log(10.f) / t60) * phase, -0.99999f, 0.99999f);
+
+			// add last delay sample to form a feedback loop and write the whole group in one go
+			float_4 delay_in = audio_in + a_last_out[g] * decay;
+			delay_in.store(&a_arena[a_write][c]);
+
+			// filter frequency with keytracking on the resonators own base pitch and filter spread
+			float_4 filter_norm = filter_knob + inputs[IN_FLTR_FREQ].getPolyVoltageSimd<float_4>(c) / 5.f * filter_att;
+			if (a_keytrack == 1) filter_norm += (std::log2(dsp::FREQ_C4) + tune_base - log_min) / log_range;
+			filter_norm = simd::clamp(filter_norm, -1.f, 1.f);
+			float_4 filter_spread = fltr_sprd + inputs[IN_FLTR_SPRD].getPolyVoltageSimd<float_4>(c) / 5.f * fltr_sprd_att;
+			filter_norm += 0.25f * filter_spread * simd::fabs(filter_spread) * a_filter_offset[g];
+			float_4 filter_freq = simd::clamp(simd::pow(2.f, log_min + filter_norm * log_range) * a_sample_time, 0.001f, 0.499f);
+			float_4 filter_res = simd::clamp(res_knob + inputs[IN_FLTR_RES].getPolyVoltageSimd<float_4>(c) / 5.f * res_att, 0.001f, 2.f);
+
+			// the part that differs per resonator: coefficient updates and the delay line reads
+			float_4 y0, y1, frac;
+			for (int lane = 0; lane < 4; lane++) {
+				int ch = c + lane;
+				updateFilters(ch, filter_type, filter_freq[lane], filter_res[lane], freq[lane]);
+
+				// delay length in samples, minus the delay the loop filters add
+				double delay_length = a_index[ch];
+				if (a_loop_comp == 1) delay_length = std::max(delay_length - a_delay_comp[ch], 2.0);
+
+				// fixed point read position behind the shared write position
+				uint64_t delay_phase = (uint64_t)(int64_t)((delay_length + tracking) * PhaseOne);
+				uint64_t read_phase = ((uint64_t)a_write << 32) - delay_phase;
+				int read = (read_phase >> 32) & (BankLength - 1);
+				frac[lane] = (uint32_t)read_phase * (1.f / PhaseOne);
+				if (a_fresh[ch] < BankLength) a_fresh[ch]++;
+				y0[lane] = arenaSample(ch, read);
+				y1[lane] = arenaSample(ch, (read + 1) & (BankLength - 1));
+			}
+
+			// linear interpolation, loop filter, dc blocker and saturation for four resonators at once
+			float_4 delay_out = y0 + frac * (y1 - y0);
+			if (a_type != 5) delay_out = a_filter[g].process(delay_out);
+			delay_out = a_dc_block[g].process(delay_out);
+			delay_out = simd::clamp(saturate(delay_out * feedback), -2.f, 2.f);
+			a_last_out[g] = delay_out;
+
+			// VCA modulation with unipolar CV if connected, then the dry / wet mix
+			float_4 vca = vca_connected ? simd::clamp(inputs[IN_VCA].getPolyVoltageSimd<float_4>(c) / 5.f, 0.f, 1.f) : float_4(1.f);
+			delay_out = delay_out * vca_knob * vca;
+			float_4 mix = simd::clamp(mix_knob + inputs[IN_DRYWET].getPolyVoltageSimd<float_4>(c) / 5.f * mix_att, 0.f, 1.f);
+			outs[g] = audio_in + (delay_out - audio_in) * mix;
+
+			out_left += outs[g] * a_gain_left[g];
+			out_right += outs[g] * a_gain_right[g];
+		}
+
+		// increment the shared write position for the next sample
+		a_write = (a_write + 1) & (BankLength - 1);
+
+		// set audio outputs, rescaled to -5V to +5V
+		if (a_poly_out == 1) {
+			outputs[OUT_AUDIO_LEFT].setChannels(count);
+			outputs[OUT_AUDIO_RIGHT].setChannels(count);
+			for (int g = 0; g < groups; g++) {
+				outputs[OUT_AUDIO_LEFT].setVoltageSimd(outs[g] * 5.f, g * 4);
+				outputs[OUT_AUDIO_RIGHT].setVoltageSimd(outs[g] * 5.f, g * 4);
+			}
+		} else {
+			outputs[OUT_AUDIO_LEFT].setChannels(1);
+			outputs[OUT_AUDIO_RIGHT].setChannels(1);
+			outputs[OUT_AUDIO_LEFT].setVoltage((out_left[0] + out_left[1] + out_left[2] + out_left[3]) * 5.f);
+			outputs[OUT_AUDIO_RIGHT].setVoltage((out_right[0] + out_right[1] + out_right[2] + out_right[3]) * 5.f);
+		}
+
+		// keep the worst case process time
+		if (a_measure_time) {
+			float elapsed = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - process_start).count();
+			if (elapsed > a_peak_time.load(std::memory_order_relaxed)) a_peak_time.store(elapsed, std::memory_order_relaxed);
+		}
+	}
+
+
+	// LAYOUT
+
+	// stereo gains and spread offsets, the same distribution alae uses for its unison voices
+	void updateLayout(int count, bool stereo) {
+		int layout = count | (stereo << 5) | (a_tune_sprd_mode << 6) | (a_fltr_sprd_mode << 7);
+		if (layout == a_layout_last) return;
+		a_layout_last = layout;
+
+		for (int ch = 0; ch < BankMax; ch++) {
+			int g = ch / 4, lane = ch % 4;
+			bool active = ch < count;
+			float left = 0.f, right = 0.f;
+
+			// if the count is odd resonator 0 sits in the center, the rest alternate between the outputs
+			if (!active) {
+			} else if (!stereo || (count % 2 == 1 && ch == 0)) {
+				left = right = 1.f / count;
+			} else if (ch % 2 == 0) {
+				left = 1.f / (count / 2);
+			} else {
+				right = 1.f / (count / 2);
+			}
+			a_gain_left[g][lane] = left;
+			a_gain_right[g][lane] = right;
+			a_active[g][lane] = active ? 1.f : 0.f;
+
+			// resonators spread symmetrically around the base values
+			float offset = ch - (count - 1) * 0.5f;
+			a_tune_offset[g][lane] = offset * ((a_tune_sprd_mode == 1) ? a_inharm_factor[ch] : 1.f);
+			a_filter_offset[g][lane] = offset * ((a_fltr_sprd_mode == 1) ? a_inharm_factor[ch] : 1.f);
+		}
+	}
+
+
+	// LOOP FILTER
+
+	// recalculate the coefficients of one resonator only if frequency, resonance or type changed and copy them into its lane
+	void updateFilters(int ch, dsp::BiquadFilter::Type type, float filter_freq, float filter_res, float freq) {
+		int g = ch / 4, lane = ch % 4;
+
+		if (a_type == 5) {
+			if (a_filter_type_last[ch] != 5) a_comp_dirty[ch] = true;
+			a_filter_type_last[ch] = 5;
+		} else if (filter_freq != a_filter_freq_last[ch] || filter_res != a_filter_res_last[ch] || a_type != a_filter_type_last[ch]) {
+			a_filter_design[ch].setParameters(type, filter_freq, filter_res, 1.0f);
+			a_filter[g].setLane(lane, a_filter_design[ch]);
+			a_filter_freq_last[ch] = filter_freq;
+			a_filter_res_last[ch] = filter_res;
+			a_filter_type_last[ch] = a_type;
+			a_comp_dirty[ch] = true;
+		}
+
+		// filter out low frequencys 6 octaves below the pitch to prevent low frequency build ups, closer to the pitch it would
+		// stretch the partials apart
+		float dc_block_freq = clamp(freq / 64, 1.f, a_nyquist);
+		if (dc_block_freq != a_dc_block_freq_last[ch]) {
+			a_dc_block_design[ch].setParameters(dsp::BiquadFilter::HIGHPASS, dc_block_freq * a_sample_time, 0.701, 1.0f);
+			a_dc_block[g].setLane(lane, a_dc_block_design[ch]);
+			a_dc_block_freq_last[ch] = dc_block_freq;
+			a_comp_dirty[ch] = true;
+		}
+
+		// loop delay compensation, in the delay range only the feedback sample is compensated
+		if (a_comp_dirty[ch] || freq != a_comp_freq[ch]) {
+			float w = freq * a_angular_time;
+			a_delay_comp[ch] = 1.0;
+			if (freq > 20.f) a_delay_comp[ch] += getLoopDelay(a_dc_block_design[ch], a_type != 5 ? &a_filter_design[ch] : nullptr, w);
+			a_comp_freq[ch] = freq;
+			a_comp_dirty[ch] = false;
+		}
+	}
+
+
+	// saturation functions, the same curves as alae for four lanes
+
+	float_4 tanhSaturation(float_4 x) {
+		return 1.f - 2.f / (simd::exp(2.f * x) + 1.f);
+	}
+
+	float_4 saturate(float_4 x) {
+		float_4 sign = simd::ifelse(x > 0.f, 1.f, -1.f);
+    	switch (a_sat_select) {
+        	case  1: return tanhSaturation(x);
+       	 	case  2: return simd::ifelse(x > 1.f, 1.f, simd::ifelse(x < -1.f, -1.f, x - (x * x * x) / 3.f));
+       		case  3: return simd::clamp(x, -1.f, 1.f);
+    	    case  4: return (1.f - simd::exp(-simd::fabs(x))) * sign;
+    	    case  5: return x / (1.f + 5.f * simd::fabs(x));
+    	    case  6: return simd::atan(x);
+    	    case  7: return simd::clamp(x - (x * x * x) / 3.f, -5.f, 5.f);
+    	    case  8: return simd::ifelse(x > 0.f, tanhSaturation(x), x / (1.f + simd::fabs(x)));
+    	    case  9: return x / (1.f + simd::exp(-x));
+    	    case 10: return x - 0.5f * x * x + 0.1f * x * x * x;
+    	    case 11: return simd::sin(x);
+        	default: return x;
+    	}
+	}
+
+
+	// RESET AND RETRIGGER
+
+	// a sample of the delay line of one resonator, the ones from before its last reset stand for silence or the noise burst
+	float arenaSample(int ch, int pos) {
+		int age = (a_write - pos) & (BankLength - 1);
+		if (age < a_fresh[ch]) return a_arena[pos][ch];
+		return (((a_burst_end[ch] - 1 - pos) & (BankLength - 1)) < a_burst[ch]) ? burstNoise(a_burst_seed[ch], pos) : 0.f;
+	}
+
+	// silence one resonator: its filter lanes at once, its column of the arena lazily (see arenaSample)
+	void resetResonator(int ch) {
+		int g = ch / 4, lane = ch % 4;
+		a_fresh[ch] = 0;
+		a_burst[ch] = 0;
+		a_burst_end[ch] = a_write;
+		a_filter[g].resetLane(lane);
+		a_dc_block[g].resetLane(lane);
+		a_last_out[g][lane] = 0.f;
+	}
+
+	// reset a resonator and excite it with exactly one period of noise, straight in its delay line
+	void retriggerResonator(int ch) {
+		resetResonator(ch);
+		a_burst[ch] = clamp((int)a_index[ch], 1, BankLength);
+		a_burst_seed[ch] = random::u32();
+	}
+
+	// initialize from the module menu also silences the resonators
+	void onReset(const ResetEvent& e) override {
+		Module::onReset(e);
+		for (int ch = 0; ch < BankMax; ch++) {
+			resetResonator(ch);
+		}
+	}
+
+
+	// SAMPLE RATE
+
+	void setSampleRate(float sampleRate) {
+		a_sample_rate = sampleRate;
+		a_sample_time = 1.f / sampleRate;
+		a_nyquist = sampleRate / 2.f;
+		a_angular_time = 2.f * M_PI / sampleRate;
+
+		// lowest possible pitch 1VOct factor, based on the sample rate and the arena length
+		a_lowest_pitch = std::log2((sampleRate / BankLength) / dsp::FREQ_C4);
+
+		// normalized coefficients are stale now, force the next sample to recalculate them
+		for (int ch = 0; ch < BankMax; ch++) {
+			a_filter_freq_last[ch] = 0.f;
+			a_dc_block_freq_last[ch] = 0.f;
+			a_comp_dirty[ch] = true;
+		}
+	}
+
+	void onSampleRateChange(const SampleRateChangeEvent& e) override {
+		setSampleRate(e.sampleRate);
+	}
+
+
+   // Override `dataToJson` to save values without a param to JSON
+    json_t *dataToJson() override {
+        // Create a JSON object
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "a_type", json_integer(a_type));
+        json_object_set_new(rootJ, "a_keytrack", json_integer(a_keytrack));
+        json_object_set_new(rootJ, "a_sat_select", json_integer(a_sat_select));
+        json_object_set_new(rootJ, "a_tune_sprd_mode", json_integer(a_tune_sprd_mode));
+        json_object_set_new(rootJ, "a_fltr_sprd_mode", json_integer(a_fltr_sprd_mode));
+        json_object_set_new(rootJ, "a_loop_comp", json_integer(a_loop_comp));
+        json_object_set_new(rootJ, "a_poly_out", json_integer(a_poly_out));
+
+        return rootJ;
+    }
+
+    // Override `dataFromJson` to load the values from JSON
+    void dataFromJson(json_t *rootJ) override {
+        json_t *intJ1 = json_object_get(rootJ, "a_type");
+        if (intJ1) a_type = json_integer_value(intJ1);
+
+        json_t *intJ2 = json_object_get(rootJ, "a_keytrack");
+        if (intJ2) a_keytrack = json_integer_value(intJ2);
+
+        json_t *intJ3 = json_object_get(rootJ, "a_sat_select");
+        if (intJ3) a_sat_select = json_integer_value(intJ3);
+
+        json_t *intJ4 = json_object_get(rootJ, "a_tune_sprd_mode");
+        if (intJ4) a_tune_sprd_mode = json_integer_value(intJ4);
+
+        json_t *intJ5 = json_object_get(rootJ, "a_fltr_sprd_mode");
+        if (intJ5) a_fltr_sprd_mode = json_integer_value(intJ5);
+
+        json_t *intJ6 = json_object_get(rootJ, "a_loop_comp");
+        if (intJ6) a_loop_comp = json_integer_value(intJ6);
+
+        json_t *intJ7 = json_object_get(rootJ, "a_poly_out");
+        if (intJ7) a_poly_out = json_integer_value(intJ7);
+    }
+};
+
+
+// module widget constructor
+struct AlaeBankWidget : AlaePanelWidget {
+	AlaeBankWidget(AlaeBank* module) : AlaePanelWidget(module) {}
+
+
+	// create the right click menus
+	void appendContextMenu(Menu* menu) override {
+	    ModuleWidget::appendContextMenu(menu);
+
+	    // Cast the module to access its variable
+	    AlaeBank* module = dynamic_cast<AlaeBank*>(this->module);
+	    if (!module) return;
+
+	    // Add a separator
+	    menu->addChild(new MenuSeparator);
+
+    	appendSaturationMenu(menu, module);
+
+		// Add a separator
+	    menu->addChild(new MenuSeparator);
+
+	    menu->addChild(this->createMenuItem("Filter Delay Compensation", module->a_loop_comp == 1 ? "✔" : "", 	[module]() { module->a_loop_comp ^= 1; }));
+
+    	// Add a separator
+	    menu->addChild(new MenuSeparator);
+
+    	appendSpreadMenus(menu, module);
+
+		menu->addChild(new MenuSeparator);
+
+    	menu->addChild(this->createMenuItem("Polyphonic outputs (one channel per resonator)", module->a_poly_out == 1 ? "✔" : "", [module]() { module->a_poly_out ^= 1; }));
+
+		menu->addChild(new MenuSeparator);
+
+		// the worst time divided by the resonator count compares directly to the meter of a single alae
+    	menu->addChild(this->createMenuItem("Measure worst process time", module->a_measure_time == 1 ? string::f("%.1f µs (%.2f per resonator)", module->a_peak_time.load(), module->a_peak_time.load() / std::max(module->a_count, 1)) : "", [module]() {
+    		module->a_measure_time ^= 1;
+    		module->a_peak_time = 0.f;
+    	}));
+	}
+};
+
+
+
+Model* modelAlaeBank = createModel<AlaeBank, AlaeBankWidget>("AlaeBank");
@@ -1,5 +1,6 @@
 #pragma once
 #include <rack.hpp>
+#include <complex>
 
 
 using namespace rack;
@@ -10,4 +11,287 @@ extern Plugin* pluginInstance;
 // Declare each Model, defined in each module source file
 // extern Model* modelMyModule;
 //extern Model* model_testmod;
-extern Model* modelAlae;
\ No newline at end of file
+extern Model* modelAlae;
+extern Model* modelAlaeBank;
+
+
+// one sample in the 32.32 fixed point read phase of the delay lines
+#define PhaseOne (uint64_t(1) << 32)
+
+
+// noise burst of a retrigger, a hash of the delay line position so a sample settles to the same value every time it is read
+inline float burstNoise(uint32_t seed, int pos) {
+	uint32_t x = seed ^ (uint32_t(pos) * 0x9e3779b9u);
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x * (2.f / 4294967296.f) - 1.f;
+}
+
+
+// create custom knobs
+
+
+struct BigLuggezKnob : RoundKnob {
+	BigLuggezKnob() {
+		setSvg(APP->window->loadSvg(asset::plugin(pluginInstance, "res/BigLuggezKnob.svg")));
+	}
+};
+
+struct MediumLuggezKnob : RoundKnob {
+	MediumLuggezKnob() {
+		setSvg(APP->window->loadSvg(asset::plugin(pluginInstance, "res/MediumLuggezKnob.svg")));
+	}
+};
+
+struct SmallLuggezKnob : RoundKnob {
+	SmallLuggezKnob() {
+		setSvg(APP->window->loadSvg(asset::plugin(pluginInstance, "res/SmallLuggezKnob.svg")));
+	}
+};
+
+
+// ids shared by alae and alae bank, both modules use the same panel
+
+struct AlaeIds {
+	enum ParamId {
+		ATT_TUNE_TRCK,
+		ATT_TUNE_FM,
+		PRM_TUNE,
+		PRM_FINE_TUNE,
+		ATT_TUNE_SPRD,
+		PRM_TUNE_SPRD,
+		PRM_VOX_COUNT,
+		ATT_FLTR_FREQ,
+		PRM_FLTR_FREQ,
+		ATT_FLTR_SPRD,
+		PRM_FLTR_SPRD,
+		ATT_FLTR_RES,
+		PRM_FLTR_RES,
+		ATT_DEC,
+		PRM_DEC,
+		ATT_FB,
+		PRM_FB,
+		PRM_VCA,
+		ATT_DRYWET,
+		PRM_DRYWET,
+		ATT_FB_IN,
+		BTN_TYPE,
+		BTN_KEYTRACK,
+		PARAMS_LEN
+	};
+	enum InputId {
+		IN_TUNE_1VOCT,
+		IN_TUNE_FM,
+		IN_TUNE_SPRD,
+		IN_FLTR_FREQ,
+		IN_FLTR_SPRD,
+		IN_FLTR_RES,
+		IN_DEC,
+		IN_FB,
+		IN_VCA,
+		IN_DRYWET,
+		IN_AUDIO,
+		IN_AUDIO_FB,
+		IN_GATE,
+		INPUTS_LEN
+	};
+	enum OutputId {
+		OUT_AUDIO_LEFT,
+		OUT_AUDIO_RIGHT,
+		OUTPUTS_LEN
+	};
+	enum LightId {
+		LGHT_LP,
+		LGHT_BP,
+		LGHT_HP,
+		LGHT_NO,
+		LGHT_TYPE,
+		LGHT_KEYTRACK,
+		LIGHTS_LEN
+	};
+};
+
+
+// response of a biquad at the normalized angular frequency w (b and a coefficients as used by rack, a0 = 1), adds its
+// group delay in samples to group
+inline std::complex<float> getResponse(const dsp::BiquadFilter& filter, float w, float& group) {
+	std::complex<float> z1 = std::polar(1.f, -w);
+	std::complex<float> z2 = z1 * z1;
+	std::complex<float> b = filter.b[0] + filter.b[1] * z1 + filter.b[2] * z2;
+	std::complex<float> a = 1.f + filter.a[0] * z1 + filter.a[1] * z2;
+	// a zero right on w has no defined group delay, the partial there does not ring anyway
+	if (std::norm(b) > 1e-12f) group += std::real((filter.b[1] * z1 + 2.f * filter.b[2] * z2) / b);
+	group -= std::real((filter.a[0] * z1 + 2.f * filter.a[1] * z2) / a);
+	return b / a;
+}
+
+// loop delay compensation in samples for a pitch at the normalized angular frequency w: the phase delay of the loop filters
+// over the first partials. a single delay can only tune all of them if the filters delay every partial the same, so it
+// takes the weighted mean that centers the partials on the harmonic series. every partial moves by its phase delay error
+// over the group delay of the whole loop there, and counts as much as it rings. filter is null if the loop runs without it
+inline float getLoopDelay(const dsp::BiquadFilter& dc_block, const dsp::BiquadFilter* filter, float w) {
+	const int partials = 4;
+	float phase_delay[partials], group_delay[partials], weight[partials];
+	float mean = 0.f, total = 0.f;
+	int count = 0;
+	for (; count < partials && (count + 1) * w < 0.9f * float(M_PI); count++) {
+		float w_k = (count + 1) * w, group = 0.f;
+		std::complex<float> h = getResponse(dc_block, w_k, group);
+		float lag = -std::arg(h);
+		if (filter) {
+			std::complex<float> h_filter = getResponse(*filter, w_k, group);
+			lag -= std::arg(h_filter);
+			h *= h_filter;
+		}
+		// the peak of a partial grows with 1 / (1 - loop gain)
+		float ring = 1.f / std::max(1.f - std::abs(h), 0.01f);
+		phase_delay[count] = lag / w_k;
+		group_delay[count] = group;
+		weight[count] = ring * ring;
+		mean += weight[count] * phase_delay[count];
+		total += weight[count];
+	}
+	if (count == 0) return 0.f;
+	mean /= total;
+
+	// the group delay of the loop is the period minus the compensation plus the group delay of the filters
+	float period = 2.f * float(M_PI) / w, delay = 0.f;
+	total = 0.f;
+	for (int k = 0; k < count; k++) {
+		float spread = weight[k] / std::max(period - mean + group_delay[k], 1.f);
+		delay += spread * phase_delay[k];
+		total += spread;
+	}
+	return delay / total;
+}
+
+
+// panel, jacks and the shared right click menus of alae and alae bank
+
+struct AlaePanelWidget : ModuleWidget {
+	AlaePanelWidget(Module* module) {
+		setModule(module);
+		// load panel svg
+		setPanel(createPanel(asset::plugin(pluginInstance, "res/alae_v2_rev3.svg")));
+
+		// place screws
+		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
+		addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
+		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+		addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+		// place components
+		addParam(createParamCentered<BigLuggezKnob>(mm2px(Vec(36.852, 20.109)), module, AlaeIds::PRM_TUNE));
+		addParam(createParamCentered<BigLuggezKnob>(mm2px(Vec(64.852, 20.109)), module, AlaeIds::PRM_FLTR_FREQ));
+
+		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(36.852, 58.814)), module, AlaeIds::PRM_TUNE_SPRD));
+		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(50.852, 48.069)), module, AlaeIds::PRM_VOX_COUNT));
+		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(64.852, 58.814)), module, AlaeIds::PRM_FLTR_SPRD));
+		addParam(createParamCentered<SmallLuggezKnob> (mm2px(Vec(64.852, 39.924)), module, AlaeIds::PRM_FLTR_RES));
+		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(16.852, 77.028)), module, AlaeIds::PRM_DEC));
+		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(84.852, 77.620)), module, AlaeIds::PRM_FB));
+		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(64.852, 87.220)), module, AlaeIds::PRM_VCA));
+		addParam(createParamCentered<MediumLuggezKnob>(mm2px(Vec(36.852, 87.220)), module, AlaeIds::PRM_DRYWET));
+
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(21.852,  12.942)), module, AlaeIds::ATT_TUNE_TRCK));
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(21.852,  36.424)), module, AlaeIds::ATT_TUNE_FM));
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(21.852,  58.424)), module, AlaeIds::ATT_TUNE_SPRD)); 
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(79.852,  12.924)), module, AlaeIds::ATT_FLTR_FREQ));
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(79.852,  58.424)), module, AlaeIds::ATT_FLTR_SPRD));
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(79.852,  36.424)), module, AlaeIds::ATT_FLTR_RES));
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(16.852,  90.636)), module, AlaeIds::ATT_DEC));
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(84.852,  91.228)), module, AlaeIds::ATT_FB));
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(50.852,  95.825)), module, AlaeIds::ATT_DRYWET));
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(50.852, 115.078)), module, AlaeIds::ATT_FB_IN));
+		addParam(createParamCentered<SmallLuggezKnob>(mm2px(Vec(36.852,  39.924)), module, AlaeIds::PRM_FINE_TUNE));
+
+
+		// place jacks
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec( 8.738,  13.217)), module, AlaeIds::IN_TUNE_1VOCT));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec( 8.738,  36.717)), module, AlaeIds::IN_TUNE_FM));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec( 8.738,  58.217)), module, AlaeIds::IN_TUNE_SPRD));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(92.738,  13.217)), module, AlaeIds::IN_FLTR_FREQ));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(92.738,  36.717)), module, AlaeIds::IN_FLTR_RES));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(92.738,  58.127)), module, AlaeIds::IN_FLTR_SPRD));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(16.738, 104.670)), module, AlaeIds::IN_DEC));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(84.738, 104.670)), module, AlaeIds::IN_FB));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(10.926, 116.117)), module, AlaeIds::IN_AUDIO));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(64.738, 104.670)), module, AlaeIds::IN_VCA));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(36.738, 104.670)), module, AlaeIds::IN_DRYWET));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(22.550, 116.117)), module, AlaeIds::IN_AUDIO_FB));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(64.738, 116.117)), module, AlaeIds::IN_GATE));
+	
+		addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(78.926, 116.117)), module, AlaeIds::OUT_AUDIO_LEFT));
+		addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(90.550, 116.117)), module, AlaeIds::OUT_AUDIO_RIGHT));
+
+
+
+		// place buttons
+		addParam(createLightParamCentered<VCVLightButton<MediumSimpleLight<YellowLight>>>(mm2px(Vec(50.852, 68.999)), module, AlaeIds::BTN_TYPE, AlaeIds::LGHT_TYPE));
+		addParam(createLightParamCentered<VCVLightButton<MediumSimpleLight<YellowLight>>>(mm2px(Vec(50.852, 19.986)), module, AlaeIds::BTN_KEYTRACK, AlaeIds::LGHT_KEYTRACK));
+		
+		// place lights
+		addChild(createLightCentered<SmallLight<YellowLight>>(mm2px(Vec(44.316, 74.655)), module, AlaeIds::LGHT_LP));
+		addChild(createLightCentered<SmallLight<YellowLight>>(mm2px(Vec(48.673, 74.655)), module, AlaeIds::LGHT_BP));
+		addChild(createLightCentered<SmallLight<YellowLight>>(mm2px(Vec(53.031, 74.655)), module, AlaeIds::LGHT_HP));
+		addChild(createLightCentered<SmallLight<YellowLight>>(mm2px(Vec(57.389, 74.655)), module, AlaeIds::LGHT_NO));
+	}
+
+
+	// create custom menu items for the right click menu
+	MenuItem* createMenuItem(const std::string& label, const std::string& rightText, std::function<void()> action) {
+	    struct ActionMenuItem : MenuItem {
+	        std::function<void()> action;
+	        void onAction(const event::Action& e) override {
+	            if (action)
+	                action();
+	        }
+	    };
+
+	    ActionMenuItem* item = new ActionMenuItem();
+	    item->text = label;
+	    item->rightText = rightText;
+	    item->action = action;
+	    return item;
+	}
+
+	// saturation curve menu, a_sat_select is the same on both modules
+	template <class TModule>
+	void appendSaturationMenu(Menu* menu, TModule* module) {
+    	menu->addChild(createSubmenuItem("Saturation Type", "", [module, this](Menu* submenu) {
+		    // Add menu items with checkmarks
+		    submenu->addChild(this->createMenuItem("tanh", module->a_sat_select == 1 ? "✔" : "", 				[module]() { module->a_sat_select = 1; }));
+		    submenu->addChild(this->createMenuItem("soft clipping", module->a_sat_select == 2 ? "✔" : "", 		[module]() { module->a_sat_select = 2; }));
+		    submenu->addChild(this->createMenuItem("hard clipping", module->a_sat_select == 3 ? "✔" : "", 		[module]() { module->a_sat_select = 3; }));
+		    submenu->addChild(this->createMenuItem("exponential", module->a_sat_select == 4 ? "✔" : "", 		[module]() { module->a_sat_select = 4; }));
+		    submenu->addChild(this->createMenuItem("sigmoid", module->a_sat_select == 5 ? "✔" : "", 			[module]() { module->a_sat_select = 5; }));
+		    submenu->addChild(this->createMenuItem("atan", module->a_sat_select == 6 ? "✔" : "", 				[module]() { module->a_sat_select = 6; }));
+		    submenu->addChild(this->createMenuItem("cubic", module->a_sat_select == 7 ? "✔" : "", 				[module]() { module->a_sat_select = 7; }));
+		    submenu->addChild(this->createMenuItem("asymetric", module->a_sat_select == 8 ? "✔" : "", 			[module]() { module->a_sat_select = 8; }));
+		    submenu->addChild(this->createMenuItem("soft exponential", module->a_sat_select == 9 ? "✔" : "",	[module]() { module->a_sat_select = 9; }));
+		    submenu->addChild(this->createMenuItem("waveshaper", module->a_sat_select == 10 ? "✔" : "", 		[module]() { module->a_sat_select = 10; }));
+		    submenu->addChild(this->createMenuItem("sine", module->a_sat_select == 11 ? "✔" : "",		 		[module]() { module->a_sat_select = 11; }));
+		}));
+	}
+
+	// tuning and filter spread menus
+	template <class TModule>
+	void appendSpreadMenus(Menu* menu, TModule* module) {
+    	menu->addChild(createSubmenuItem("Spread type - Tuning", "", [module, this](Menu* submenu) {
+		    // Add menu items with checkmarks
+		    submenu->addChild(this->createMenuItem("Even", 		module->a_tune_sprd_mode == 0 ? "✔" : "", 	[module]() { module->a_tune_sprd_mode = 0; }));
+		    submenu->addChild(this->createMenuItem("Random", 	module->a_tune_sprd_mode == 1 ? "✔" : "", 	[module]() { module->a_tune_sprd_mode = 1; }));
+		}));
+
+		menu->addChild(new MenuSeparator);
+
+    	menu->addChild(createSubmenuItem("Spread type - Filter", "", [module, this](Menu* submenu) {
+		    // Add menu items with checkmarks
+		    submenu->addChild(this->createMenuItem("Even", 		module->a_fltr_sprd_mode == 0 ? "✔" : "", 	[module]() { module->a_fltr_sprd_mode = 0; }));
+		    submenu->addChild(this->createMenuItem("Random", 	module->a_fltr_sprd_mode == 1 ? "✔" : "", 	[module]() { module->a_fltr_sprd_mode = 1; }));
+		}));
+	}
+};
\ No newline at end of file
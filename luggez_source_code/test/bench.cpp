@@ -0,0 +1,145 @@
+// ALAE BENCHMARK - cpu cost of one alae bank with n resonators against n alae instances with one voice each.
+// all of them run the same patch: default knobs, one gate every half second on every resonator and quiet noise on the
+// audio input. prints the mean time of a 128 sample block at 48khz and its share of the realtime budget of that block.
+// then the cost of the body convolver against the length of a stereo impulse response
+
+#include "../src/alae.cpp"
+#include "../src/alae_bank.cpp"
+
+Plugin* pluginInstance = nullptr;
+
+#define BlockSize (128)
+#define SampleRate (48000.f)
+#define WarmupBlocks (100)
+#define MeasureBlocks (2000)
+
+static const double block_budget = 1e6 * BlockSize / SampleRate;
+
+static void changeSampleRate(Module* module) {
+	APP->engine->sampleRate = SampleRate;
+	Module::SampleRateChangeEvent e;
+	e.sampleRate = SampleRate;
+	e.sampleTime = 1.f / SampleRate;
+	module->onSampleRateChange(e);
+}
+
+// the same inputs for every resonator: a spread of pitches, gates and noise
+static void driveInputs(Module* module, int first, int channels, long frame) {
+	Input& pitch = module->inputs[AlaeIds::IN_TUNE_1VOCT];
+	Input& gate = module->inputs[AlaeIds::IN_GATE];
+	Input& audio = module->inputs[AlaeIds::IN_AUDIO];
+	pitch.channels = gate.channels = audio.channels = channels;
+	for (int c = 0; c < channels; c++) {
+		pitch.voltages[c] = ((first + c) % 12) / 12.f - 1.f;
+		gate.voltages[c] = (frame % 24000 < 1200) ? 10.f : 0.f;
+		audio.voltages[c] = 0.1f * random::uniform() - 0.05f;
+	}
+}
+
+// mean time of one block in microseconds, every module runs its share of the block the way the engine does it
+static double measure(std::vector<Module*>& modules, int channels) {
+	Module::ProcessArgs args;
+	args.sampleRate = SampleRate;
+	args.sampleTime = 1.f / SampleRate;
+
+	double total = 0.0;
+	for (int block = 0; block < WarmupBlocks + MeasureBlocks; block++) {
+		long frame = long(block) * BlockSize;
+		for (size_t m = 0; m < modules.size(); m++) driveInputs(modules[m], m * channels, channels, frame);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (Module* module : modules) {
+			for (int i = 0; i < BlockSize; i++) {
+				args.frame = frame + i;
+				module->process(args);
+			}
+		}
+		double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		if (block >= WarmupBlocks) total += elapsed;
+	}
+	return total / MeasureBlocks;
+}
+
+static double benchBank(int count) {
+	AlaeBank* bank = new AlaeBank;
+	changeSampleRate(bank);
+	bank->params[AlaeIds::PRM_VOX_COUNT].setValue(count);
+	std::vector<Module*> modules(1, bank);
+	double time = measure(modules, count);
+	delete bank;
+	return time;
+}
+
+static double benchAlae(int count) {
+	std::vector<Module*> modules;
+	for (int i = 0; i < count; i++) {
+		Alae* alae = new Alae;
+		changeSampleRate(alae);
+		alae->params[AlaeIds::PRM_VOX_COUNT].setValue(1);
+		modules.push_back(alae);
+	}
+	double time = measure(modules, 1);
+	for (Module* module : modules) delete module;
+	return time;
+}
+
+// the convolver does its short fft work once every BodyBlock samples and spreads the long partitions over the blocks in
+// between, so every engine block carries about the same share
+static void benchBody(float seconds, int& partitions, int& long_partitions, double& mean, double& percentile, double& worst) {
+	int length = int(SampleRate * seconds);
+	std::vector<float> ir[2];
+	for (int c = 0; c < 2; c++) {
+		ir[c].resize(length);
+		for (int i = 0; i < length; i++) ir[c][i] = (2.f * random::uniform() - 1.f) * std::exp(-6.f * i / length);
+	}
+	BodyConvolver* body = new BodyConvolver;
+	body->setImpulseResponse(ir, 2);
+	partitions = body->partitions;
+	long_partitions = body->long_partitions;
+
+	std::vector<double> times;
+	for (int block = 0; block < WarmupBlocks + MeasureBlocks; block++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < BlockSize; i++) {
+			float left = 2.f * random::uniform() - 1.f, right = 2.f * random::uniform() - 1.f;
+			body->process(left, right);
+		}
+		double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		if (block >= WarmupBlocks) times.push_back(elapsed);
+	}
+	delete body;
+
+	std::sort(times.begin(), times.end());
+	mean = 0.0;
+	for (double t : times) mean += t / times.size();
+	percentile = times[times.size() * 999 / 1000];
+	worst = times.back();
+}
+
+
+int main() {
+	// the rack engine flushes denormals on its threads
+	_MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+	_MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+
+	std::printf("%d sample blocks at %.0f Hz, budget %.1f us per block\n\n", BlockSize, SampleRate, block_budget);
+	std::printf("resonators   alae bank            n x alae (1 voice)   speedup\n");
+	for (int count = 1; count <= BankMax; count++) {
+		double bank = benchBank(count);
+		double alae = benchAlae(count);
+		std::printf("%10d   %7.1f us %5.1f %%   %7.1f us %5.1f %%   %5.2f x\n", count,
+					bank, 100.0 * bank / block_budget, alae, 100.0 * alae / block_budget, alae / bank);
+	}
+
+	// the worst block includes preemption by the os, the percentile is closer to the dsp cost
+	std::printf("\nbody ir     partitions %d / %d   mean                 99.9%%                worst\n", BodyBlock, BodyLongBlock);
+	const float lengths[] = {0.1f, 0.25f, 0.5f, 1.f, 2.f, 3.f};
+	for (float seconds : lengths) {
+		int partitions, long_partitions;
+		double mean, percentile, worst;
+		benchBody(seconds, partitions, long_partitions, mean, percentile, worst);
+		std::printf("%8.2f s   %10d / %4d   %7.1f us %5.1f %%   %7.1f us %5.1f %%   %7.1f us %5.1f %%\n", seconds, partitions, long_partitions,
+					mean, 100.0 * mean / block_budget, percentile, 100.0 * percentile / block_budget, worst, 100.0 * worst / block_budget);
+	}
+	return 0;
+}
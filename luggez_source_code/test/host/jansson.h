@@ -0,0 +1,37 @@
+// minimal jansson for the standalone tests - integers, strings and objects, enough for dataToJson / dataFromJson
+// objects own their values like json_object_set_new does, nothing is reference counted
+
+#pragma once
+#include <map>
+#include <string>
+
+struct json_t {
+	enum Type { OBJECT, INTEGER, STRING } type;
+	long long integer = 0;
+	std::string string;
+	std::map<std::string, json_t*> members;
+	json_t(Type type) : type(type) {}
+	~json_t() { for (auto& m : members) delete m.second; }
+};
+typedef long long json_int_t;
+
+inline json_t* json_object() { return new json_t(json_t::OBJECT); }
+inline json_t* json_integer(json_int_t value) { json_t* j = new json_t(json_t::INTEGER); j->integer = value; return j; }
+inline json_t* json_string(const char* value) { json_t* j = new json_t(json_t::STRING); j->string = value; return j; }
+inline void json_decref(json_t* j) { delete j; }
+
+inline int json_object_set_new(json_t* object, const char* key, json_t* value) {
+	json_t*& slot = object->members[key];
+	delete slot;
+	slot = value;
+	return 0;
+}
+// compares in place like jansson does, a std::string key would allocate for the longer names
+inline json_t* json_object_get(const json_t* object, const char* key) {
+	for (auto& m : object->members) {
+		if (m.first == key) return m.second;
+	}
+	return nullptr;
+}
+inline json_int_t json_integer_value(const json_t* j) { return j && j->type == json_t::INTEGER ? j->integer : 0; }
+inline const char* json_string_value(const json_t* j) { return j && j->type == json_t::STRING ? j->string.c_str() : nullptr; }
@@ -0,0 +1,464 @@
+// minimal rack host for the standalone tests - only what the alae modules use, with working dsp parts
+// the engine side (params, ports, filters, triggers, fft, simd) behaves like rack 2, the ui side is just enough to compile
+
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <complex>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <algorithm>
+#include <pmmintrin.h>
+#include <sys/stat.h>
+#include <jansson.h>
+
+
+namespace rack {
+
+
+namespace math {
+template <typename T> T clamp(T x, T a, T b) { return std::max(std::min(x, b), a); }
+inline float rescale(float x, float xMin, float xMax, float yMin, float yMax) { return yMin + (x - xMin) / (xMax - xMin) * (yMax - yMin); }
+template <typename T> T crossfade(T a, T b, T p) { return a + (b - a) * p; }
+struct Vec {
+	float x = 0.f, y = 0.f;
+	Vec() {}
+	Vec(float x, float y) : x(x), y(y) {}
+};
+}
+using namespace math;
+
+
+// sse float_4 like rack's, the comparisons return lane masks
+namespace simd {
+struct float_4 {
+	__m128 v;
+	float_4() {}
+	float_4(__m128 v) : v(v) {}
+	float_4(float x) : v(_mm_set1_ps(x)) {}
+	float_4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+	static float_4 load(const float* p) { return float_4(_mm_loadu_ps(p)); }
+	void store(float* p) const { _mm_storeu_ps(p, v); }
+	float& operator[](int i) { return reinterpret_cast<float*>(&v)[i]; }
+	const float& operator[](int i) const { return reinterpret_cast<const float*>(&v)[i]; }
+};
+
+inline float_4 operator+(float_4 a, float_4 b) { return _mm_add_ps(a.v, b.v); }
+inline float_4 operator-(float_4 a, float_4 b) { return _mm_sub_ps(a.v, b.v); }
+inline float_4 operator*(float_4 a, float_4 b) { return _mm_mul_ps(a.v, b.v); }
+inline float_4 operator/(float_4 a, float_4 b) { return _mm_div_ps(a.v, b.v); }
+inline float_4& operator+=(float_4& a, float_4 b) { return a = a + b; }
+inline float_4& operator-=(float_4& a, float_4 b) { return a = a - b; }
+inline float_4& operator*=(float_4& a, float_4 b) { return a = a * b; }
+inline float_4& operator/=(float_4& a, float_4 b) { return a = a / b; }
+inline float_4 operator-(float_4 a) { return _mm_sub_ps(_mm_setzero_ps(), a.v); }
+inline float_4 operator>(float_4 a, float_4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline float_4 operator<(float_4 a, float_4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline float_4 operator>=(float_4 a, float_4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline float_4 operator<=(float_4 a, float_4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline float_4 operator&(float_4 a, float_4 b) { return _mm_and_ps(a.v, b.v); }
+inline float_4 operator|(float_4 a, float_4 b) { return _mm_or_ps(a.v, b.v); }
+
+inline float_4 fmax(float_4 a, float_4 b) { return _mm_max_ps(a.v, b.v); }
+inline float_4 fmin(float_4 a, float_4 b) { return _mm_min_ps(a.v, b.v); }
+inline float_4 clamp(float_4 x, float_4 a, float_4 b) { return fmax(fmin(x, b), a); }
+inline float_4 ifelse(float_4 mask, float_4 a, float_4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+inline float_4 fabs(float_4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+inline float_4 sgn(float_4 a) { return ifelse(a > 0.f, 1.f, ifelse(a < 0.f, -1.f, 0.f)); }
+
+// transcendental functions lane by lane, rack uses sse_mathfun but the results are the same within float precision
+#define HOST_LANEWISE(name, fn) \
+	inline float_4 name(float_4 a) { float_4 r; for (int i = 0; i < 4; i++) r[i] = fn(a[i]); return r; }
+HOST_LANEWISE(exp, std::exp)
+HOST_LANEWISE(log2, std::log2)
+HOST_LANEWISE(tanh, std::tanh)
+HOST_LANEWISE(atan, std::atan)
+HOST_LANEWISE(sin, std::sin)
+HOST_LANEWISE(cos, std::cos)
+#undef HOST_LANEWISE
+inline float_4 pow(float_4 a, float_4 b) { float_4 r; for (int i = 0; i < 4; i++) r[i] = std::pow(a[i], b[i]); return r; }
+inline float_4 pow(float a, float_4 b) { float_4 r; for (int i = 0; i < 4; i++) r[i] = std::pow(a, b[i]); return r; }
+}
+
+
+namespace random {
+// xorshift, deterministic so the runs are comparable
+inline uint32_t& state() { static uint32_t s = 0x2545f491; return s; }
+inline uint32_t u32() { uint32_t& s = state(); s ^= s << 13; s ^= s >> 17; s ^= s << 5; return s; }
+inline float uniform() { return (u32() >> 8) * (1.f / 16777216.f); }
+inline float normal() { return std::sqrt(-2.f * std::log(uniform() + 1e-12f)) * std::cos(2.f * float(M_PI) * uniform()); }
+}
+
+
+namespace string {
+inline std::string f(const char* format, ...) {
+	char buf[1024];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	return buf;
+}
+inline std::string filename(const std::string& path) { size_t p = path.find_last_of('/'); return p == std::string::npos ? path : path.substr(p + 1); }
+inline std::string directory(const std::string& path) { size_t p = path.find_last_of('/'); return p == std::string::npos ? "" : path.substr(0, p); }
+}
+
+
+namespace system {
+inline std::string join(const std::string& a, const std::string& b) { return a + "/" + b; }
+inline bool exists(const std::string& path) { struct stat st; return stat(path.c_str(), &st) == 0; }
+inline bool remove(const std::string& path) { return std::remove(path.c_str()) == 0; }
+inline std::string getDirectory(const std::string& path) { return string::directory(path); }
+inline std::string getFilename(const std::string& path) { return string::filename(path); }
+inline bool copy(const std::string& from, const std::string& to) {
+	FILE* in = std::fopen(from.c_str(), "rb");
+	if (!in) return false;
+	FILE* out = std::fopen(to.c_str(), "wb");
+	if (!out) { std::fclose(in); return false; }
+	char buf[4096];
+	size_t n;
+	while ((n = std::fread(buf, 1, sizeof(buf), in)) > 0) std::fwrite(buf, 1, n, out);
+	std::fclose(in);
+	std::fclose(out);
+	return true;
+}
+}
+
+
+namespace dsp {
+static const float FREQ_C4 = 261.6256f;
+
+// same direct form and coefficient design as rack's dsp/filter.hpp
+template <int B_ORDER, int A_ORDER, typename T = float>
+struct IIRFilter {
+	T b[B_ORDER] = {};
+	T a[A_ORDER - 1] = {};
+	T x[B_ORDER - 1];
+	T y[A_ORDER - 1];
+
+	IIRFilter() { reset(); }
+	void reset() {
+		for (int i = 0; i < B_ORDER - 1; i++) x[i] = 0.f;
+		for (int i = 0; i < A_ORDER - 1; i++) y[i] = 0.f;
+	}
+	T process(T in) {
+		T out = b[0] * in;
+		for (int i = 1; i < B_ORDER; i++) out += b[i] * x[i - 1];
+		for (int i = 1; i < A_ORDER; i++) out -= a[i - 1] * y[i - 1];
+		for (int i = B_ORDER - 2; i > 0; i--) x[i] = x[i - 1];
+		x[0] = in;
+		for (int i = A_ORDER - 2; i > 0; i--) y[i] = y[i - 1];
+		y[0] = out;
+		return out;
+	}
+};
+
+template <typename T = float>
+struct TBiquadFilter : IIRFilter<3, 3, T> {
+	enum Type { LOWPASS_1POLE, HIGHPASS_1POLE, LOWPASS, HIGHPASS, LOWSHELF, HIGHSHELF, BANDPASS, PEAK, NOTCH, NUM_TYPES };
+
+	TBiquadFilter() { setParameters(LOWPASS, 0.f, 0.f, 1.f); }
+
+	// f is the cutoff normalized to the sample rate
+	void setParameters(Type type, float f, float Q, float V) {
+		T* b = this->b;
+		T* a = this->a;
+		float K = std::tan(float(M_PI) * f);
+		float norm = 1.f / (1.f + K / Q + K * K);
+		switch (type) {
+			case LOWPASS_1POLE:
+				a[0] = -std::exp(-2.f * float(M_PI) * f); a[1] = 0.f;
+				b[0] = 1.f + a[0]; b[1] = 0.f; b[2] = 0.f;
+				break;
+			case HIGHPASS_1POLE:
+				a[0] = std::exp(-2.f * float(M_PI) * (0.5f - f)); a[1] = 0.f;
+				b[0] = 1.f - a[0]; b[1] = 0.f; b[2] = 0.f;
+				break;
+			case LOWPASS:
+				b[0] = K * K * norm; b[1] = 2.f * b[0]; b[2] = b[0];
+				a[0] = 2.f * (K * K - 1.f) * norm; a[1] = (1.f - K / Q + K * K) * norm;
+				break;
+			case HIGHPASS:
+				b[0] = norm; b[1] = -2.f * b[0]; b[2] = b[0];
+				a[0] = 2.f * (K * K - 1.f) * norm; a[1] = (1.f - K / Q + K * K) * norm;
+				break;
+			case BANDPASS:
+				b[0] = K / Q * norm; b[1] = 0.f; b[2] = -b[0];
+				a[0] = 2.f * (K * K - 1.f) * norm; a[1] = (1.f - K / Q + K * K) * norm;
+				break;
+			case NOTCH:
+				b[0] = (1.f + K * K) * norm; b[1] = 2.f * (K * K - 1.f) * norm; b[2] = b[0];
+				a[0] = b[1]; a[1] = (1.f - K / Q + K * K) * norm;
+				break;
+			default:
+				// shelves and peak are not used by the modules, pass through
+				b[0] = 1.f; b[1] = 0.f; b[2] = 0.f; a[0] = 0.f; a[1] = 0.f;
+				break;
+		}
+	}
+};
+typedef TBiquadFilter<> BiquadFilter;
+
+struct BooleanTrigger {
+	bool state = true;
+	bool process(bool s) {
+		bool triggered = s && !state;
+		state = s;
+		return triggered;
+	}
+};
+
+template <typename T = float>
+struct TSchmittTrigger {
+	bool state = true;
+	bool process(T in, T offThreshold = 0.f, T onThreshold = 1.f) {
+		if (state) {
+			if (in <= offThreshold) state = false;
+		} else if (in >= onThreshold) {
+			state = true;
+			return true;
+		}
+		return false;
+	}
+	bool isHigh() { return state; }
+	void reset() { state = true; }
+};
+typedef TSchmittTrigger<> SchmittTrigger;
+
+// real fft in pffft's ordered format [dc, nyquist, re1, im1, ...], unnormalized like rack's. all tables are made in the constructor
+struct RealFFT {
+	size_t length;
+	std::vector<std::complex<float>> twiddles, work;
+	std::vector<size_t> reversed;
+
+	RealFFT(size_t length) : length(length), twiddles(length / 2), work(length), reversed(length) {
+		for (size_t k = 0; k < length / 2; k++) twiddles[k] = std::polar(1.f, -2.f * float(M_PI) * k / length);
+		size_t bits = 0;
+		while ((size_t(1) << bits) < length) bits++;
+		for (size_t i = 0; i < length; i++) {
+			size_t r = 0;
+			for (size_t j = 0; j < bits; j++) if (i & (size_t(1) << j)) r |= size_t(1) << (bits - 1 - j);
+			reversed[i] = r;
+		}
+	}
+
+	// iterative radix 2 over work, which is already in bit reversed order
+	void transform(bool inverse) {
+		for (size_t size = 2; size <= length; size *= 2) {
+			size_t step = length / size;
+			for (size_t start = 0; start < length; start += size) {
+				for (size_t k = 0; k < size / 2; k++) {
+					std::complex<float> w = twiddles[k * step];
+					if (inverse) w = std::conj(w);
+					std::complex<float> t = w * work[start + k + size / 2];
+					work[start + k + size / 2] = work[start + k] - t;
+					work[start + k] += t;
+				}
+			}
+		}
+	}
+
+	void rfft(const float* input, float* output) {
+		for (size_t i = 0; i < length; i++) work[reversed[i]] = input[i];
+		transform(false);
+		output[0] = work[0].real();
+		output[1] = work[length / 2].real();
+		for (size_t k = 1; k < length / 2; k++) {
+			output[2 * k] = work[k].real();
+			output[2 * k + 1] = work[k].imag();
+		}
+	}
+
+	void irfft(const float* input, float* output) {
+		for (size_t k = 0; k < length; k++) {
+			std::complex<float> c;
+			if (k == 0) c = input[0];
+			else if (k == length / 2) c = input[1];
+			else if (k < length / 2) c = std::complex<float>(input[2 * k], input[2 * k + 1]);
+			else c = std::complex<float>(input[2 * (length - k)], -input[2 * (length - k) + 1]);
+			work[reversed[k]] = c;
+		}
+		transform(true);
+		for (size_t i = 0; i < length; i++) output[i] = work[i].real();
+	}
+
+	void scale(float* x) {
+		for (size_t i = 0; i < length; i++) x[i] /= length;
+	}
+};
+}
+
+
+// engine side
+
+
+namespace engine {
+struct Engine {
+	float sampleRate = 48000.f;
+	float getSampleRate() { return sampleRate; }
+};
+}
+
+struct Svg;
+struct Window {
+	Svg* loadSvg(std::string) { return nullptr; }
+};
+
+struct Context {
+	engine::Engine* engine;
+	Window* window;
+};
+inline Context* appGet() {
+	static engine::Engine engine;
+	static Window window;
+	static Context context = {&engine, &window};
+	return &context;
+}
+#define APP rack::appGet()
+
+struct ParamQuantity {
+	float minValue = 0.f, maxValue = 1.f, defaultValue = 0.f;
+	std::string name;
+};
+
+struct Param {
+	float value = 0.f;
+	float getValue() { return value; }
+	void setValue(float v) { value = v; }
+};
+
+#define PORT_MAX_CHANNELS 16
+
+struct Port {
+	float voltages[PORT_MAX_CHANNELS] = {};
+	int channels = 0;
+	bool isConnected() { return channels > 0; }
+	int getChannels() { return channels; }
+	void setChannels(int c) { channels = c; }
+	float getVoltage(int c = 0) { return voltages[c]; }
+	void setVoltage(float v, int c = 0) { voltages[c] = v; }
+	float getPolyVoltage(int c) { return channels == 1 ? voltages[0] : voltages[c]; }
+	template <typename T> T getPolyVoltageSimd(int c) { return channels == 1 ? T(voltages[0]) : T::load(&voltages[c]); }
+	template <typename T> void setVoltageSimd(T v, int c) { v.store(&voltages[c]); }
+};
+struct Input : Port {};
+struct Output : Port {};
+
+struct Light {
+	float value = 0.f;
+	void setBrightness(float b) { value = b; }
+};
+
+struct Module {
+	std::vector<Param> params;
+	std::vector<Input> inputs;
+	std::vector<Output> outputs;
+	std::vector<Light> lights;
+	std::vector<ParamQuantity> paramQuantities;
+	std::string patchStorage = "/tmp/alae_host_storage";
+
+	struct ProcessArgs { float sampleRate; float sampleTime; int64_t frame; };
+	struct SampleRateChangeEvent { float sampleRate; float sampleTime; };
+	struct ResetEvent {};
+	struct SaveEvent {};
+	struct AddEvent {};
+	struct RemoveEvent {};
+
+	void config(int numParams, int numInputs, int numOutputs, int numLights) {
+		params.resize(numParams);
+		inputs.resize(numInputs);
+		outputs.resize(numOutputs);
+		lights.resize(numLights);
+		paramQuantities.resize(numParams);
+	}
+	ParamQuantity* configParam(int id, float minValue, float maxValue, float defaultValue, std::string name = "", std::string = "", float = 0.f, float = 1.f, float = 0.f) {
+		ParamQuantity& q = paramQuantities[id];
+		q.minValue = minValue;
+		q.maxValue = maxValue;
+		q.defaultValue = defaultValue;
+		q.name = name;
+		params[id].value = defaultValue;
+		return &q;
+	}
+	ParamQuantity* configButton(int id, std::string name = "") { return configParam(id, 0.f, 1.f, 0.f, name); }
+	void configInput(int, std::string = "") {}
+	void configOutput(int, std::string = "") {}
+
+	std::string getPatchStorageDirectory() { return patchStorage; }
+	std::string createPatchStorageDirectory() { mkdir(patchStorage.c_str(), 0755); return patchStorage; }
+
+	virtual ~Module() {}
+	virtual void process(const ProcessArgs&) {}
+	virtual void onSampleRateChange(const SampleRateChangeEvent&) {}
+	virtual void onReset(const ResetEvent&) {}
+	virtual void onSave(const SaveEvent&) {}
+	virtual void onAdd(const AddEvent&) {}
+	virtual void onRemove(const RemoveEvent&) {}
+	virtual json_t* dataToJson() { return nullptr; }
+	virtual void dataFromJson(json_t*) {}
+};
+
+
+// ui side, compiles but draws nothing
+
+
+struct Plugin {
+	void addModel(struct Model*) {}
+};
+struct Model {};
+template <class TModule, class TModuleWidget> Model* createModel(std::string) { static Model model; return &model; }
+
+namespace asset {
+inline std::string plugin(Plugin*, std::string path) { return path; }
+inline std::string user(std::string path) { return path; }
+}
+namespace event { struct Action {}; }
+
+struct Widget {
+	struct { math::Vec size; } box;
+	virtual ~Widget() {}
+	void addChild(Widget* w) { delete w; }
+	virtual void step() {}
+};
+struct MenuItem : Widget {
+	std::string text, rightText;
+	virtual void onAction(const event::Action&) {}
+};
+struct MenuSeparator : Widget {};
+struct MenuLabel : Widget { std::string text; };
+struct Menu : Widget {};
+inline MenuItem* createSubmenuItem(std::string text, std::string rightText, std::function<void(Menu*)>) { MenuItem* item = new MenuItem; item->text = text; item->rightText = rightText; return item; }
+
+struct RoundKnob : Widget { void setSvg(Svg*) {} };
+struct ScrewSilver : Widget {};
+struct PJ301MPort : Widget {};
+struct YellowLight : Widget {};
+template <class T> struct VCVLightButton : Widget {};
+template <class T> struct MediumSimpleLight : Widget {};
+template <class T> struct SmallLight : Widget {};
+
+struct ModuleWidget : Widget {
+	Module* module = nullptr;
+	void setModule(Module* m) { module = m; }
+	void setPanel(Widget* w) { delete w; }
+	void addParam(Widget* w) { delete w; }
+	void addInput(Widget* w) { delete w; }
+	void addOutput(Widget* w) { delete w; }
+	virtual void appendContextMenu(Menu*) {}
+};
+inline Widget* createPanel(std::string) { return new Widget; }
+template <class T> T* createWidget(math::Vec) { return new T; }
+template <class T> T* createParamCentered(math::Vec, Module*, int) { return new T; }
+template <class T> T* createInputCentered(math::Vec, Module*, int) { return new T; }
+template <class T> T* createOutputCentered(math::Vec, Module*, int) { return new T; }
+template <class T> T* createLightParamCentered(math::Vec, Module*, int, int) { return new T; }
+template <class T> T* createLightCentered(math::Vec, Module*, int) { return new T; }
+inline math::Vec mm2px(math::Vec mm) { return math::Vec(mm.x * 75.f / 25.4f, mm.y * 75.f / 25.4f); }
+static const float RACK_GRID_WIDTH = 15.f, RACK_GRID_HEIGHT = 380.f;
+
+
+}
@@ -0,0 +1,29 @@
+// minimal libsamplerate for the standalone tests - linear interpolation instead of sinc, the converter type is ignored
+
+#pragma once
+
+typedef struct {
+	const float* data_in;
+	float* data_out;
+	long input_frames, output_frames;
+	long input_frames_used, output_frames_gen;
+	int end_of_input;
+	double src_ratio;
+} SRC_DATA;
+
+enum { SRC_SINC_BEST_QUALITY, SRC_SINC_MEDIUM_QUALITY, SRC_SINC_FASTEST, SRC_ZERO_ORDER_HOLD, SRC_LINEAR };
+
+inline int src_simple(SRC_DATA* data, int, int channels) {
+	if (channels != 1 || data->src_ratio <= 0.0) return 1;
+	long frames = 0;
+	for (; frames < data->output_frames; frames++) {
+		double pos = frames / data->src_ratio;
+		long i = (long)pos;
+		if (i + 1 >= data->input_frames) break;
+		double frac = pos - i;
+		data->data_out[frames] = float(data->data_in[i] * (1.0 - frac) + data->data_in[i + 1] * frac);
+	}
+	data->input_frames_used = data->input_frames;
+	data->output_frames_gen = frames;
+	return 0;
+}
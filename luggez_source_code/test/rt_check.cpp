@@ -0,0 +1,383 @@
+// ALAE REALTIME CHECK - runs the process() of alae and alae bank through every mode, voice count and parameter sweep
+// with malloc / free / pthread_mutex_lock interposed. any call to them from inside process() or from the events the engine
+// sends under its lock (sample rate change, reset, patch load) is a failure.
+// prints the mean and 99.9th percentile cpu time of a 128 sample block for every module and sample rate, and the worst
+// wall clock time of a block (it includes preemption by the os, the cpu time of the thread leaves it out). the run fails
+// (exit code 1) on any hit, non-finite output or a percentile over the realtime budget of the block at its sample rate
+
+#include "../src/alae.cpp"
+#include "../src/alae_bank.cpp"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+Plugin* pluginInstance = nullptr;
+
+#define BlockSize (128)
+
+
+// interposed allocator and lock. the test thread arms them around the process() calls and the locked events, other
+// threads never count
+
+
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void __libc_free(void*);
+}
+
+static thread_local bool t_armed = false;
+static int g_hits = 0;
+static const char* g_hit_name[16];
+static char g_hit_case[16][128];
+static char g_case[128] = "";
+
+// called with the hooks armed, so it only copies into static memory
+static void hit(const char* name) {
+	if (g_hits < 16) {
+		g_hit_name[g_hits] = name;
+		std::memcpy(g_hit_case[g_hits], g_case, sizeof(g_case));
+	}
+	g_hits++;
+}
+
+extern "C" {
+void* malloc(size_t size) {
+	if (t_armed) hit("malloc");
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+	if (t_armed) hit("calloc");
+	return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size) {
+	if (t_armed) hit("realloc");
+	return __libc_realloc(p, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+	if (t_armed) hit("memalign");
+	return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+	if (t_armed) hit("aligned_alloc");
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** p, size_t alignment, size_t size) {
+	if (t_armed) hit("posix_memalign");
+	*p = __libc_memalign(alignment, size);
+	return *p ? 0 : 12;
+}
+
+void free(void* p) {
+	if (t_armed && p) hit("free");
+	__libc_free(p);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+	typedef int (*LockFunction)(pthread_mutex_t*);
+	static LockFunction next = nullptr;
+	if (t_armed) hit("pthread_mutex_lock");
+	if (!next) next = (LockFunction)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+	return next(mutex);
+}
+}
+
+// resolve the real lock before the first armed call, dlsym allocates
+__attribute__((constructor)) static void resolveHooks() {
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_mutex_lock(&mutex);
+	pthread_mutex_unlock(&mutex);
+}
+
+
+// test driver
+
+
+struct Run {
+	const char* name;
+	double worst_block = 0.0;
+	char worst_case[128] = "";
+	std::map<float, std::vector<double>> times; // cpu time per sample rate
+	long non_finite = 0;
+	Run(const char* name) : name(name) {}
+};
+
+// one block of BlockSize process() calls with the hooks armed, the same way the engine calls it
+static void processBlock(Module* module, Run& run, float sample_rate, int64_t& frame) {
+	Module::ProcessArgs args;
+	args.sampleRate = sample_rate;
+	args.sampleTime = 1.f / sample_rate;
+
+	timespec cpu_start, cpu_end;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	t_armed = true;
+	for (int i = 0; i < BlockSize; i++) {
+		args.frame = frame++;
+		module->process(args);
+	}
+	t_armed = false;
+	double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+	double cpu = (cpu_end.tv_sec - cpu_start.tv_sec) * 1e6 + (cpu_end.tv_nsec - cpu_start.tv_nsec) * 1e-3;
+
+	if (elapsed > run.worst_block) {
+		run.worst_block = elapsed;
+		std::memcpy(run.worst_case, g_case, sizeof(g_case));
+	}
+	run.times[sample_rate].push_back(cpu);
+
+	for (Output& output : module->outputs) {
+		for (int c = 0; c < std::max(output.channels, 1); c++) {
+			if (!std::isfinite(output.voltages[c])) run.non_finite++;
+		}
+	}
+}
+
+// every parameter moves through its whole range at its own rate, the endpoints included
+static void sweepParams(Module* module, long step, int skip) {
+	for (size_t p = 0; p < module->params.size(); p++) {
+		if ((int)p == skip) continue;
+		ParamQuantity& q = module->paramQuantities[p];
+		float phase = std::fmod(step * (0.013f + 0.007f * p) + 0.37f * p, 2.f);
+		float x = phase < 1.f ? phase : 2.f - phase;
+		module->params[p].setValue(q.minValue + (q.maxValue - q.minValue) * x);
+	}
+}
+
+// cv, audio and gate inputs: the 1v/oct input crosses the delay tuning range, the pool threshold and the audio range
+static void driveInputs(Module* module, long step, int channels) {
+	for (size_t i = 0; i < module->inputs.size(); i++) {
+		Input& input = module->inputs[i];
+		// every input gets disconnected now and then
+		input.channels = ((step / 7 + i) % 5 == 0) ? 0 : channels;
+		for (int c = 0; c < PORT_MAX_CHANNELS; c++) input.voltages[c] = 10.f * random::uniform() - 5.f;
+	}
+	Input& pitch = module->inputs[AlaeIds::IN_TUNE_1VOCT];
+	for (int c = 0; c < PORT_MAX_CHANNELS; c++) pitch.voltages[c] = std::fmod(step * 0.11f + c * 0.5f, 16.f) - 10.f;
+	Input& gate = module->inputs[AlaeIds::IN_GATE];
+	for (int c = 0; c < PORT_MAX_CHANNELS; c++) gate.voltages[c] = ((step + c) % 3 == 0) ? 10.f : 0.f;
+}
+
+// write a decaying noise impulse response as 16 bit wav
+static void writeImpulseResponse(const std::string& path, float sample_rate, float seconds) {
+	int frames = int(sample_rate * seconds);
+	std::vector<int16_t> data(frames);
+	for (int i = 0; i < frames; i++) data[i] = int16_t(32000.f * (2.f * random::uniform() - 1.f) * std::exp(-6.f * i / frames));
+
+	FILE* file = std::fopen(path.c_str(), "wb");
+	uint32_t rate = uint32_t(sample_rate), bytes = frames * 2, size = 36 + bytes, fmt_size = 16, byte_rate = rate * 2;
+	uint16_t format = 1, channels = 1, align = 2, bits = 16;
+	std::fwrite("RIFF", 1, 4, file); std::fwrite(&size, 4, 1, file); std::fwrite("WAVE", 1, 4, file);
+	std::fwrite("fmt ", 1, 4, file); std::fwrite(&fmt_size, 4, 1, file); std::fwrite(&format, 2, 1, file);
+	std::fwrite(&channels, 2, 1, file); std::fwrite(&rate, 4, 1, file); std::fwrite(&byte_rate, 4, 1, file);
+	std::fwrite(&align, 2, 1, file); std::fwrite(&bits, 2, 1, file);
+	std::fwrite("data", 1, 4, file); std::fwrite(&bytes, 4, 1, file); std::fwrite(data.data(), 2, frames, file);
+	std::fclose(file);
+}
+
+// the events the engine sends under its lock, armed like process()
+static void changeSampleRate(Module* module, float sample_rate) {
+	APP->engine->sampleRate = sample_rate;
+	Module::SampleRateChangeEvent e;
+	e.sampleRate = sample_rate;
+	e.sampleTime = 1.f / sample_rate;
+	t_armed = true;
+	module->onSampleRateChange(e);
+	t_armed = false;
+}
+
+// initialize from the menu, then load the module's own json back like a preset. the json is built by the ui side
+static void resetAndReload(Module* module) {
+	json_t* rootJ = module->dataToJson();
+	t_armed = true;
+	module->onReset(Module::ResetEvent());
+	module->dataFromJson(rootJ);
+	t_armed = false;
+	json_decref(rootJ);
+}
+
+// capture the live state and recall it again through the audio thread handoff, the ui side runs between the blocks
+static void captureAndRecall(Alae* alae, Run& run, float sample_rate, int64_t& frame) {
+	ResonatorSnapshot* snapshot = new ResonatorSnapshot;
+	for (int ch = 0; ch < uni_chans; ch++) snapshot->samples[ch].resize(BufferLength);
+	delete alae->a_capture.exchange(snapshot);
+	while (!alae->a_captured.load()) processBlock(alae, run, sample_rate, frame);
+
+	delete alae->a_recall.exchange(alae->a_captured.exchange(nullptr));
+	while (!alae->a_recalled.load()) processBlock(alae, run, sample_rate, frame);
+	alae->collectTransfers();
+}
+
+// the new rate waits until the ui side has resampled the tails and the audio thread takes it over with their recall.
+// blocks keep running at the old rate meanwhile, the way the engine only sees the new one after the event
+static void settleSampleRate(Alae* alae, Run& run, float old_rate, int64_t& frame) {
+	while (alae->a_rate_pending.load() > 0.f) {
+		processBlock(alae, run, old_rate, frame);
+		alae->collectTransfers();
+	}
+	alae->collectTransfers();
+	if (alae->a_body_thread.joinable()) alae->a_body_thread.join();
+}
+
+static void runAlae(Run& run, const std::string& storage) {
+	Alae* alae = new Alae;
+	alae->patchStorage = storage;
+	alae->a_measure_time = 1;
+	int64_t frame = 0;
+	long step = 0;
+
+	std::string ir_path = storage + "_ir.wav";
+	writeImpulseResponse(ir_path, 44100.f, 0.5f);
+	alae->onAdd(Module::AddEvent());
+
+	const float rates[2] = {48000.f, 96000.f};
+	for (float sample_rate : rates) {
+		float old_rate = alae->a_sample_rate;
+		std::snprintf(g_case, sizeof(g_case), "alae %.0f Hz, sample rate change", sample_rate);
+		changeSampleRate(alae, sample_rate);
+		settleSampleRate(alae, run, old_rate, frame);
+
+		for (int voices = 1; voices <= uni_chans; voices++) {
+			for (int delay_mode = 0; delay_mode < 3; delay_mode++) {
+				for (int interpolation = 1; interpolation <= 6; interpolation++) {
+					for (int type = 1; type <= 5; type++) {
+						alae->a_delay_mode = delay_mode;
+						alae->InterpolationSelect = interpolation;
+						alae->a_type = type;
+						alae->a_sat_select = 1 + step % 11;
+						alae->a_excite_mode = step % 3;
+						alae->a_tune_sprd_mode = step % 2;
+						alae->a_fltr_sprd_mode = (step / 2) % 2;
+						alae->a_loop_comp = (step / 4) % 2;
+						alae->a_keytrack = (step / 8) % 2;
+
+						// body convolver on for every other combination, loaded and cleared the way the menu does it
+						if (step % 2 == 0) {
+							alae->setBody(ir_path);
+							alae->a_body_thread.join();
+						} else {
+							alae->clearBody();
+						}
+
+						for (int block = 0; block < 6; block++, step++) {
+							sweepParams(alae, step, AlaeIds::PRM_VOX_COUNT);
+							alae->params[AlaeIds::PRM_VOX_COUNT].setValue(voices);
+							driveInputs(alae, step, 1);
+							std::snprintf(g_case, sizeof(g_case), "alae %.0f Hz, %d voices, delay mode %d, interpolation %d, type %d, sat %d",
+										  sample_rate, voices, delay_mode, interpolation, type, alae->a_sat_select);
+							processBlock(alae, run, sample_rate, frame);
+						}
+					}
+				}
+				std::snprintf(g_case, sizeof(g_case), "alae %.0f Hz, %d voices, delay mode %d, snapshot capture / recall", sample_rate, voices, delay_mode);
+				captureAndRecall(alae, run, sample_rate, frame);
+
+				// the body of the reloaded json gets loaded or cleared again by the ui side
+				std::snprintf(g_case, sizeof(g_case), "alae %.0f Hz, %d voices, delay mode %d, reset and reload", sample_rate, voices, delay_mode);
+				resetAndReload(alae);
+				alae->collectTransfers();
+				if (alae->a_body_thread.joinable()) alae->a_body_thread.join();
+			}
+		}
+	}
+
+	delete alae;
+	system::remove(ir_path);
+	system::remove(system::join(storage, "body.wav"));
+}
+
+static void runBank(Run& run) {
+	AlaeBank* bank = new AlaeBank;
+	bank->a_measure_time = 1;
+	int64_t frame = 0;
+	long step = 0;
+
+	const float rates[2] = {48000.f, 96000.f};
+	for (float sample_rate : rates) {
+		std::snprintf(g_case, sizeof(g_case), "alae bank %.0f Hz, sample rate change", sample_rate);
+		changeSampleRate(bank, sample_rate);
+
+		for (int count = 1; count <= BankMax; count++) {
+			for (int type = 1; type <= 5; type++) {
+				for (int poly = 0; poly < 2; poly++) {
+					bank->a_type = type;
+					bank->a_poly_out = poly;
+					bank->a_sat_select = 1 + step % 11;
+					bank->a_tune_sprd_mode = step % 2;
+					bank->a_fltr_sprd_mode = (step / 2) % 2;
+					bank->a_loop_comp = (step / 4) % 2;
+					bank->a_keytrack = (step / 8) % 2;
+
+					// a bank block is cheap, more of them keep preemption by the os out of the percentile
+					for (int block = 0; block < 30; block++, step++) {
+						sweepParams(bank, step, AlaeIds::PRM_VOX_COUNT);
+						// the resonator count comes from the knob or from the channels of the polyphonic 1v/oct input
+						bank->params[AlaeIds::PRM_VOX_COUNT].setValue(count);
+						driveInputs(bank, step, (block % 2) ? count : 1);
+						std::snprintf(g_case, sizeof(g_case), "alae bank %.0f Hz, %d resonators, type %d, poly out %d, sat %d",
+									  sample_rate, count, type, poly, bank->a_sat_select);
+						processBlock(bank, run, sample_rate, frame);
+					}
+				}
+			}
+			std::snprintf(g_case, sizeof(g_case), "alae bank %.0f Hz, %d resonators, reset and reload", sample_rate, count);
+			resetAndReload(bank);
+		}
+	}
+
+	delete bank;
+}
+
+
+int main() {
+	// the rack engine flushes denormals on its threads
+	_MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+	_MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+
+	char storage[] = "/tmp/alae_rt_check_XXXXXX";
+	if (!mkdtemp(storage)) return 1;
+
+	Run runs[2] = {Run("alae"), Run("alae bank")};
+	runAlae(runs[0], storage);
+	runBank(runs[1]);
+	rmdir(storage);
+
+	int failures = 0;
+	for (Run& run : runs) {
+		for (auto& rate : run.times) {
+			std::vector<double>& times = rate.second;
+			std::sort(times.begin(), times.end());
+			double mean = 0.0;
+			for (double t : times) mean += t / times.size();
+			double percentile = times[times.size() * 999 / 1000];
+			double budget = 1e6 * BlockSize / rate.first;
+			std::printf("%-10s %6.0f Hz %6d blocks of %d samples: mean %6.1f us, 99.9%% %7.1f us of %6.1f us budget%s\n", run.name, rate.first,
+						(int)times.size(), BlockSize, mean, percentile, budget, percentile < budget ? "" : " !");
+			if (percentile >= budget) failures++;
+		}
+		std::printf("%-10s worst block %7.1f us (%s)\n", run.name, run.worst_block, run.worst_case);
+		if (run.non_finite) {
+			std::printf("%-10s %ld non-finite output samples\n", run.name, run.non_finite);
+			failures++;
+		}
+	}
+
+	for (int i = 0; i < std::min(g_hits, 16); i++) std::printf("realtime violation: %s in %s\n", g_hit_name[i], g_hit_case[i]);
+	if (g_hits) {
+		std::printf("%d calls to the allocator or a mutex from process() or a locked event\n", g_hits);
+		failures++;
+	}
+
+	std::printf(failures ? "FAILED\n" : "OK\n");
+	return failures ? 1 : 0;
+}
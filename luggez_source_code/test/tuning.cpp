@@ -0,0 +1,173 @@
+// ALAE TUNING CHECK - plucks a single resonator of alae and alae bank with an impulse and measures its first partials
+// with a windowed dft, for every filter type at low, middle and high pitches. prints the error of every partial in cents
+// against the harmonic series of the played pitch, and their mean weighted with the energy of each partial. fails (exit
+// code 1) if a partial of a harmonic case or the weighted mean of any case is further off than its tolerance. partials
+// that decayed before the analysis window have no pitch left to measure, they are marked with - and left out
+
+#include "../src/alae.cpp"
+#include "../src/alae_bank.cpp"
+
+Plugin* pluginInstance = nullptr;
+
+#define SampleRate (48000.f)
+#define Partials (4)
+#define SettleFrames (4800) // skip the attack before the analysis window
+#define WindowFrames (1<<16) // around 1,4 seconds
+#define LeakageFloor (0.005) // peak magnitude below which only the leakage of the window is left
+
+
+struct TuningCase {
+	const char* name;
+	int type; // filter type as in the modules, 5 is no loop filter
+	float filter; // filter frequency knob, keytracked
+	bool harmonic; // every partial has to be in tune, otherwise only their weighted mean
+	float tolerance; // cents
+};
+
+// lowpass and notch far above the partials and no filter keep them harmonic. the lowpass at its default cuts into the
+// upper partials, the bandpass around them and the highpass below the pitch bend the phase over the whole partial range.
+// there a single delay can only center the partials that carry the sound on the harmonic series, for the highpass with the
+// most error as its phase turns the fastest
+static const TuningCase cases[] = {
+	{"lowpass", 1, 0.4f, true, 5.f},
+	{"lowpass", 1, 0.2f, false, 5.f},
+	{"bandpass", 2, 0.15f, false, 5.f},
+	{"highpass", 3, -0.1f, false, 20.f},
+	{"notch", 4, 0.45f, true, 5.f},
+	{"none", 5, 0.f, true, 5.f},
+};
+
+static const float pitches[] = {110.f, 440.f, 1760.f};
+
+
+static void changeSampleRate(Module* module) {
+	APP->engine->sampleRate = SampleRate;
+	Module::SampleRateChangeEvent e;
+	e.sampleRate = SampleRate;
+	e.sampleTime = 1.f / SampleRate;
+	module->onSampleRateChange(e);
+}
+
+// tune knob position for a pitch in the audible range, where the knob maps 0 - 1 to -3.3 - 4.5 octaves around c4
+static float tuneKnob(float freq) {
+	return (std::log2(freq / dsp::FREQ_C4) + 3.3f) / 7.8f;
+}
+
+// one resonator with a long decay, no saturation drive and an impulse on the audio input, returns the output after the attack
+static std::vector<float> pluck(Module* module, const TuningCase& c, float freq) {
+	changeSampleRate(module);
+	module->params[AlaeIds::PRM_VOX_COUNT].setValue(1);
+	module->params[AlaeIds::PRM_TUNE].setValue(tuneKnob(freq));
+	module->params[AlaeIds::PRM_DEC].setValue(0.9f);
+	module->params[AlaeIds::PRM_FLTR_FREQ].setValue(c.filter);
+	module->params[AlaeIds::PRM_FLTR_RES].setValue(0.707f);
+	module->params[AlaeIds::PRM_FB].setValue(0.f);
+	module->params[AlaeIds::PRM_DRYWET].setValue(1.f);
+	module->inputs[AlaeIds::IN_AUDIO].channels = 1;
+	module->outputs[AlaeIds::OUT_AUDIO_LEFT].channels = 1;
+	module->outputs[AlaeIds::OUT_AUDIO_RIGHT].channels = 1;
+
+	Module::ProcessArgs args;
+	args.sampleRate = SampleRate;
+	args.sampleTime = 1.f / SampleRate;
+
+	std::vector<float> out;
+	for (int64_t frame = 0; frame < SettleFrames + WindowFrames; frame++) {
+		module->inputs[AlaeIds::IN_AUDIO].voltages[0] = (frame == 0) ? 0.5f : 0.f;
+		args.frame = frame;
+		module->process(args);
+		if (frame >= SettleFrames) out.push_back(module->outputs[AlaeIds::OUT_AUDIO_LEFT].getVoltage());
+	}
+	return out;
+}
+
+// magnitude of the hann windowed dtft at freq
+static double magnitude(const std::vector<float>& signal, double freq) {
+	double w = 2.0 * M_PI * freq / SampleRate;
+	std::complex<double> rotate = std::polar(1.0, -w), z = 1.0, sum = 0.0;
+	for (size_t i = 0; i < signal.size(); i++) {
+		double window = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / signal.size());
+		sum += z * (double)(signal[i] * window);
+		z *= rotate;
+	}
+	return std::abs(sum);
+}
+
+// the strongest peak within 300 cents of the target, coarse in 5 cent steps, then fine with a parabola through the top
+static double peakCents(const std::vector<float>& signal, double target, double& peak) {
+	double best = 0.0, best_mag = -1.0;
+	for (double cents = -300.0; cents <= 300.0; cents += 5.0) {
+		double mag = magnitude(signal, target * std::pow(2.0, cents / 1200.0));
+		if (mag > best_mag) { best_mag = mag; best = cents; }
+	}
+	double center = best;
+	for (double cents = center - 5.0; cents <= center + 5.0; cents += 0.25) {
+		double mag = magnitude(signal, target * std::pow(2.0, cents / 1200.0));
+		if (mag > best_mag) { best_mag = mag; best = cents; }
+	}
+	double left = magnitude(signal, target * std::pow(2.0, (best - 0.25) / 1200.0));
+	double right = magnitude(signal, target * std::pow(2.0, (best + 0.25) / 1200.0));
+	double curve = left - 2.0 * best_mag + right;
+	if (curve < 0.0) best += 0.25 * 0.5 * (left - right) / curve;
+	peak = best_mag;
+	return best;
+}
+
+// prints one row and returns the number of partials outside the tolerance
+static int checkModule(const char* module_name, Module* module, const TuningCase& c, float freq) {
+	std::vector<float> out = pluck(module, c, freq);
+	int failures = 0;
+	double mean = 0.0, energy = 0.0;
+	std::printf("%-5s %-9s %4.2f %7.1f Hz  ", module_name, c.name, c.filter, freq);
+	for (int k = 1; k <= Partials; k++) {
+		double peak;
+		double cents = peakCents(out, k * freq, peak);
+		bool lost = peak < LeakageFloor;
+		bool fail = !lost && c.harmonic && std::fabs(cents) > c.tolerance;
+		std::printf(" h%d %+7.1f%s", k, cents, lost ? " -" : fail ? " !" : "  ");
+		if (fail) failures++;
+		if (lost) continue;
+		mean += peak * peak * cents;
+		energy += peak * peak;
+	}
+	if (energy == 0.0) {
+		std::printf(" decayed\n");
+		return failures;
+	}
+	mean /= energy;
+	bool fail = std::fabs(mean) > c.tolerance;
+	std::printf(" mean %+6.1f%s\n", mean, fail ? " !" : "");
+	if (fail) failures++;
+	return failures;
+}
+
+
+int main() {
+	// the rack engine flushes denormals on its threads
+	_MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+	_MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+
+	int failures = 0;
+	for (const TuningCase& c : cases) {
+		for (float freq : pitches) {
+			// alae with the allpass interpolation the compensation is made for, and the bank with its linear one
+			Alae* alae = new Alae;
+			alae->a_type = c.type;
+			alae->InterpolationSelect = 6;
+			failures += checkModule("alae", alae, c, freq);
+			delete alae;
+
+			AlaeBank* bank = new AlaeBank;
+			bank->a_type = c.type;
+			failures += checkModule("bank", bank, c, freq);
+			delete bank;
+		}
+	}
+
+	if (failures) {
+		std::printf("FAILED: %d partials or means out of tune\n", failures);
+		return 1;
+	}
+	std::printf("OK\n");
+	return 0;
+}